@@ -0,0 +1,851 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <VulkanPlayground/Graphics/Device.hpp>
+#include <VulkanPlayground/Graphics/GpuProfiler.hpp>
+#include <VulkanPlayground/Graphics/Instance.hpp>
+#include <VulkanPlayground/Graphics/Pipeline.hpp>
+#include <VulkanPlayground/Graphics/PipelineCompiler.hpp>
+#include <VulkanPlayground/Graphics/ShaderReflection.hpp>
+#include <VulkanPlayground/Graphics/ShaderReflectionCache.hpp>
+#include <VulkanPlayground/Graphics/Surface.hpp>
+#include <VulkanPlayground/Graphics/Texture.hpp>
+#include <VulkanPlayground/Graphics/TextureStreamer.hpp>
+#include <VulkanPlayground/Graphics/VulkanPtr.hpp>
+#include <VulkanPlayground/Graphics/Window.hpp>
+#include <VulkanPlayground/Utils/AsyncFileReader.hpp>
+#include <VulkanPlayground/Utils/File.hpp>
+#include <VulkanPlayground/Utils/FrameStatistics.hpp>
+#include <VulkanPlayground/Utils/JobSystem.hpp>
+#include <VulkanPlayground/Utils/Logger.hpp>
+#include <VulkanPlayground/Utils/LoggerSinks.hpp>
+#include <VulkanPlayground/Utils/Profiler.hpp>
+#include <VulkanPlayground/Utils/Queue.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <thread>
+
+#include "shaders/VertexColors.hpp"
+
+// This executable bundles several throughput benchmarks. The first argument selects the benchmark,
+// all following arguments are --key value pairs which override the defaults of the benchmark.
+
+typedef std::map<std::string, std::string> Arguments;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int getInt(Arguments const& args, std::string const& key, int defaultValue) {
+  auto it = args.find(key);
+  return it == args.end() ? defaultValue : std::stoi(it->second);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double getSeconds(std::chrono::steady_clock::time_point const& start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Spins for the given time. Sleeping would give the CPU time back to the driver, which is not what
+// we want to simulate.
+void simulateWork(int microseconds) {
+  auto start = std::chrono::steady_clock::now();
+  while (getSeconds(start) * 1000000.0 < microseconds) {}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Renders the same frames with different numbers of frames in flight. Each frame spends cpu-us
+// microseconds on the CPU and draws draws overlapping quads to keep the GPU busy. With
+// --headless 1 the frames are rendered offscreen, this works without a display. The 99th
+// percentile of the CPU frame time and the mean GPU time are taken from the FrameStatistics of the
+// Surface, so they cover the last 1000 frames at most. With --trace 1, the CPU and GPU zones of all
+// runs are written to benchmark-frames.json, which can be opened with chrome://tracing.
+int benchmarkFrames(Arguments const& args) {
+  int  frames{getInt(args, "--frames", 1000)};
+  int  cpuWork{getInt(args, "--cpu-us", 2000)};
+  int  draws{getInt(args, "--draws", 2000)};
+  int  maxFramesInFlight{getInt(args, "--max-in-flight", 3)};
+  bool headless{getInt(args, "--headless", 0) != 0};
+  bool trace{getInt(args, "--trace", 0) != 0};
+
+  Illusion::Profiler::enabled = trace;
+
+  auto instance = std::make_shared<Illusion::Graphics::Instance>("Benchmark", false, headless);
+  auto device   = std::make_shared<Illusion::Graphics::Device>(instance);
+
+  std::cout << "frames in flight | ms / frame |     fps | speedup | p99 ms | gpu ms / frame"
+            << std::endl;
+
+  double baseline{0.0};
+
+  for (int framesInFlight{1}; framesInFlight <= maxFramesInFlight; ++framesInFlight) {
+    Illusion::Graphics::WindowPtr  window;
+    Illusion::Graphics::SurfacePtr surface;
+
+    if (headless) {
+      surface = std::make_shared<Illusion::Graphics::Surface>(
+        device, vk::Extent2D(800, 600), framesInFlight);
+    } else {
+      window = std::make_shared<Illusion::Graphics::Window>(device);
+      window->open(false, framesInFlight);
+      surface = window->getSurface();
+    }
+
+    std::vector<std::string> shader{"data/shaders/VertexColors.vert.spv",
+                                    "data/shaders/VertexColors.frag.spv"};
+    auto pipeline =
+      std::make_shared<Illusion::Graphics::Pipeline>(device, surface->getRenderPass(), shader, 10);
+
+    Reflection::VertexColors::PushConstants pushConstants;
+    pushConstants.pos = glm::vec2(0.0, 0.0);
+
+    auto renderFrame = [&]() {
+      if (window) { window->processInput(); }
+
+      auto frame = surface->beginFrame();
+
+      surface->beginRenderPass(frame);
+
+      {
+        ILLUSION_PROFILE_ZONE("simulateWork");
+        simulateWork(cpuWork);
+      }
+
+      {
+        ILLUSION_GPU_PROFILE_ZONE(surface->getGpuProfiler(), frame.mPrimaryCommandBuffer, "Quads");
+
+        pushConstants.time += 0.01;
+        pipeline->bind(frame);
+        pipeline->setPushConstant(frame, pushConstants);
+        frame.mPrimaryCommandBuffer.draw(4, draws, 0, 0);
+      }
+
+      surface->endRenderPass(frame);
+      surface->endFrame(frame);
+    };
+
+    // warm-up
+    for (int i{0}; i < 50; ++i) {
+      renderFrame();
+    }
+
+    auto const& statistics = surface->getFrameStatistics();
+    statistics->clear();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i{0}; i < frames; ++i) {
+      renderFrame();
+    }
+
+    device->getVkDevice()->waitIdle();
+
+    double frameTime{getSeconds(start) / frames};
+    if (framesInFlight == 1) { baseline = frameTime; }
+
+    auto cpu{statistics->getSummary(Illusion::FrameStatistics::Metric::eCpuFrameTime)};
+    auto gpu{statistics->getSummary(Illusion::FrameStatistics::Metric::eGpuFrameTime)};
+
+    std::cout << std::setw(16) << framesInFlight << " | " << std::setw(10) << std::fixed
+              << std::setprecision(3) << frameTime * 1000.0 << " | " << std::setw(7)
+              << std::setprecision(1) << 1.0 / frameTime << " | " << std::setw(6)
+              << std::setprecision(2) << baseline / frameTime << "x | " << std::setw(6)
+              << std::setprecision(3) << cpu.mP99 << " | " << std::setw(14) << gpu.mMean
+              << std::endl;
+  }
+
+  if (trace) {
+    Illusion::Profiler::saveChromeTrace("benchmark-frames.json");
+    Illusion::Profiler::enabled = false;
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates the pipelines of all example shaders --count times, first one after another on the main
+// thread, then with a PipelineCompiler with 1 to --max-threads workers. "blocking" is the time the
+// main thread spent in the constructors or in compile() respectively. Each run uses a fresh Device
+// without cache files, so the first pipeline of each shader is always a cache miss.
+int benchmarkPipelines(Arguments const& args) {
+  int hardwareThreads{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+  int count{getInt(args, "--count", 4)};
+  int maxThreads{getInt(args, "--max-threads", hardwareThreads)};
+
+  std::vector<std::vector<std::string>> shaders{
+    {"data/shaders/VertexColors.vert.spv", "data/shaders/VertexColors.frag.spv"},
+    {"data/shaders/TexturedQuad.vert.spv", "data/shaders/TexturedQuad.frag.spv"},
+    {"data/shaders/PBR.vert.spv", "data/shaders/PBR.frag.spv"}};
+
+  auto instance = std::make_shared<Illusion::Graphics::Instance>("Benchmark", false, true);
+
+  std::cout << "threads | blocking ms | total ms | speedup" << std::endl;
+
+  double baseline{0.0};
+
+  // threads == 0 means synchronous creation on the main thread
+  for (int threads{0}; threads <= maxThreads; ++threads) {
+    auto device  = std::make_shared<Illusion::Graphics::Device>(instance, "", "");
+    auto surface = std::make_shared<Illusion::Graphics::Surface>(device, vk::Extent2D(64, 64));
+
+    double blocking{0.0};
+    auto   start = std::chrono::steady_clock::now();
+
+    if (threads == 0) {
+      std::vector<Illusion::Graphics::PipelinePtr> pipelines;
+
+      for (int i{0}; i < count; ++i) {
+        for (auto const& shader : shaders) {
+          pipelines.push_back(std::make_shared<Illusion::Graphics::Pipeline>(
+            device, surface->getRenderPass(), shader, 10));
+        }
+      }
+      blocking = getSeconds(start);
+    } else {
+      Illusion::Graphics::PipelineCompiler           compiler(device, threads);
+      std::vector<Illusion::Graphics::AsyncPipeline> pipelines;
+
+      for (int i{0}; i < count; ++i) {
+        for (auto const& shader : shaders) {
+          pipelines.push_back(compiler.compile(surface->getRenderPass(), shader, 10));
+        }
+      }
+      blocking = getSeconds(start);
+
+      for (auto const& pipeline : pipelines) {
+        pipeline.wait();
+      }
+    }
+
+    double total{getSeconds(start)};
+    if (threads == 0) { baseline = total; }
+
+    std::cout << std::setw(7) << (threads == 0 ? std::string("sync") : std::to_string(threads))
+              << " | " << std::setw(11) << std::fixed << std::setprecision(2) << blocking * 1000.0
+              << " | " << std::setw(8) << total * 1000.0 << " | " << std::setw(6)
+              << baseline / total << "x" << std::endl;
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Reflects each example shader --iterations times with spirv_cross ("cold") and through a
+// ShaderReflectionCache which is loaded from disk in every iteration ("warm"). This does not
+// require a Vulkan device.
+int benchmarkReflection(Arguments const& args) {
+  int         iterations{getInt(args, "--iterations", 100)};
+  std::string fileName{"benchmark-reflection.cache"};
+
+  std::vector<std::string> shaders{"data/shaders/VertexColors.vert.spv",
+                                   "data/shaders/VertexColors.frag.spv",
+                                   "data/shaders/TexturedQuad.vert.spv",
+                                   "data/shaders/TexturedQuad.frag.spv",
+                                   "data/shaders/PBR.vert.spv",
+                                   "data/shaders/PBR.frag.spv"};
+
+  // fill the cache file
+  {
+    Illusion::Graphics::ShaderReflectionCache cache(fileName);
+    for (auto const& shader : shaders) {
+      cache.get(Illusion::File<uint32_t>(shader).map()->getSpan<uint32_t>());
+    }
+  }
+
+  std::cout << "shader                             | cold ms | warm ms | speedup" << std::endl;
+
+  for (auto const& shader : shaders) {
+    auto code = Illusion::File<uint32_t>(shader).getContent();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i{0}; i < iterations; ++i) {
+      Illusion::Graphics::ShaderReflection reflection(code);
+    }
+    double cold{getSeconds(start) / iterations};
+
+    start = std::chrono::steady_clock::now();
+    for (int i{0}; i < iterations; ++i) {
+      Illusion::Graphics::ShaderReflectionCache cache(fileName);
+      cache.get(Illusion::File<uint32_t>(shader).map()->getSpan<uint32_t>());
+    }
+    double warm{getSeconds(start) / iterations};
+
+    std::cout << std::setw(34) << std::left << shader << std::right << " | " << std::setw(7)
+              << std::fixed << std::setprecision(3) << cold * 1000.0 << " | " << std::setw(7)
+              << warm * 1000.0 << " | " << std::setw(6) << std::setprecision(1) << cold / warm
+              << "x" << std::endl;
+  }
+
+  std::remove(fileName.c_str());
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Runs two workloads on a JobSystem with 1 to --max-threads workers: a parallelFor over --items
+// indices which each do some floating point math, and --jobs tiny jobs which measure the overhead
+// of enqueueing and stealing. This does not require a Vulkan device.
+int benchmarkJobs(Arguments const& args) {
+  int hardwareThreads{static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+  int items{getInt(args, "--items", 1000000)};
+  int jobs{getInt(args, "--jobs", 100000)};
+  int maxThreads{getInt(args, "--max-threads", hardwareThreads)};
+
+  std::vector<float> results(items);
+
+  std::cout << "threads | parallel for ms | speedup | tiny jobs ms | jobs / ms" << std::endl;
+
+  double baseline{0.0};
+
+  for (int threads{1}; threads <= maxThreads; ++threads) {
+    Illusion::JobSystem jobSystem(threads);
+
+    auto start = std::chrono::steady_clock::now();
+    jobSystem.parallelFor(0, items, [&results](size_t i) {
+      float value{static_cast<float>(i)};
+      for (int j{0}; j < 100; ++j) {
+        value = std::sin(value) + std::sqrt(value + 1.f);
+      }
+      results[i] = value;
+    });
+    double parallelFor{getSeconds(start)};
+
+    if (threads == 1) { baseline = parallelFor; }
+
+    std::atomic<int>   counter{0};
+    Illusion::JobGroup group;
+
+    start = std::chrono::steady_clock::now();
+    for (int i{0}; i < jobs; ++i) {
+      jobSystem.enqueue(group, [&counter]() { ++counter; });
+    }
+    jobSystem.wait(group);
+    double tinyJobs{getSeconds(start)};
+
+    std::cout << std::setw(7) << threads << " | " << std::setw(15) << std::fixed
+              << std::setprecision(2) << parallelFor * 1000.0 << " | " << std::setw(6)
+              << baseline / parallelFor << "x | " << std::setw(12) << tinyJobs * 1000.0 << " | "
+              << std::setw(9) << std::setprecision(0) << jobs / (tinyJobs * 1000.0) << std::endl;
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Moves --items integers per producer through a queue with --producers producers and --consumers
+// consumers. The LockedQueue is compared with the lock-free BoundedQueue and UnboundedQueue, the
+// latter two also with batches of --batch items. This does not require a Vulkan device.
+int benchmarkQueues(Arguments const& args) {
+  int hardwareThreads{static_cast<int>(std::max(2u, std::thread::hardware_concurrency()))};
+  int items{getInt(args, "--items", 1000000)};
+  int producers{getInt(args, "--producers", hardwareThreads / 2)};
+  int consumers{getInt(args, "--consumers", hardwareThreads / 2)};
+  int batch{getInt(args, "--batch", 16)};
+
+  // push(values, count) and pop(values, maxCount) wrap the different interfaces
+  auto measure = [&](std::string const& name, std::function<void(int*, int)> const& push,
+                     std::function<int(int*, int)> const& pop, int batchSize) {
+    std::atomic<int64_t>     popped{0};
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i{0}; i < producers; ++i) {
+      threads.emplace_back([&]() {
+        std::vector<int> values(batchSize);
+        for (int j{0}; j < items; j += batchSize) {
+          int count{std::min(batchSize, items - j)};
+          std::iota(values.begin(), values.begin() + count, j);
+          push(values.data(), count);
+        }
+      });
+    }
+
+    for (int i{0}; i < consumers; ++i) {
+      threads.emplace_back([&]() {
+        std::vector<int> values(batchSize);
+        while (popped < static_cast<int64_t>(items) * producers) {
+          int count{pop(values.data(), batchSize)};
+          if (count == 0) { std::this_thread::yield(); }
+          popped += count;
+        }
+      });
+    }
+
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    double seconds{getSeconds(start)};
+
+    std::cout << std::setw(22) << std::left << name << std::right << " | " << std::setw(9)
+              << std::fixed << std::setprecision(2) << seconds * 1000.0 << " | " << std::setw(8)
+              << items * producers / seconds / 1000000.0 << std::endl;
+  };
+
+  std::cout << "queue                  |        ms | M items / s" << std::endl;
+
+  Illusion::LockedQueue<int> locked;
+  measure("locked",
+          [&](int* values, int count) {
+            for (int i{0}; i < count; ++i) {
+              locked.push(values[i]);
+            }
+          },
+          [&](int* values, int) { return locked.pop(*values) ? 1 : 0; }, 1);
+
+  for (int batchSize : {1, batch}) {
+    std::string postfix{batchSize > 1 ? " (batch " + std::to_string(batchSize) + ")" : ""};
+
+    Illusion::BoundedQueue<int> bounded(4096);
+    measure("bounded" + postfix,
+            [&](int* values, int count) {
+              while (count > 0) {
+                int pushed{static_cast<int>(bounded.tryPush(values, count))};
+                if (pushed == 0) { std::this_thread::yield(); }
+                values += pushed;
+                count -= pushed;
+              }
+            },
+            [&](int* values, int count) { return static_cast<int>(bounded.tryPop(values, count)); },
+            batchSize);
+
+    Illusion::UnboundedQueue<int> unbounded;
+    measure("unbounded" + postfix,
+            [&](int* values, int count) { unbounded.push(values, count); },
+            [&](int* values, int count) {
+              return static_cast<int>(unbounded.tryPop(values, count));
+            },
+            batchSize);
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Reads the shaders and textures of the examples --repeat times, once after another with
+// Illusion::File and as one batch with the AsyncFileReader using both backends. Most of the files
+// will be in the page cache after the first run, drop it (echo 3 > /proc/sys/vm/drop_caches)
+// before each run to measure actual disk throughput. This does not require a Vulkan device.
+int benchmarkIo(Arguments const& args) {
+  int repeat{getInt(args, "--repeat", 50)};
+  int queueDepth{getInt(args, "--queue-depth", 64)};
+
+  std::vector<std::string> files;
+  for (int i{0}; i < repeat; ++i) {
+    files.insert(files.end(),
+      {"data/shaders/VertexColors.vert.spv", "data/shaders/VertexColors.frag.spv",
+        "data/shaders/TexturedQuad.vert.spv", "data/shaders/TexturedQuad.frag.spv",
+        "data/shaders/PBR.vert.spv", "data/shaders/PBR.frag.spv", "data/textures/box.dds"});
+  }
+
+  std::cout << "method          | files |    MB |      ms |   MB/s" << std::endl;
+
+  auto print = [&files](std::string const& method, size_t bytes, double seconds) {
+    double megaBytes{bytes / 1024.0 / 1024.0};
+    std::cout << std::setw(15) << std::left << method << std::right << " | " << std::setw(5)
+              << files.size() << " | " << std::setw(5) << std::fixed << std::setprecision(1)
+              << megaBytes << " | " << std::setw(7) << std::setprecision(2) << seconds * 1000.0
+              << " | " << std::setw(6) << std::setprecision(1) << megaBytes / seconds << std::endl;
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  size_t bytes{0};
+  for (auto const& file : files) {
+    bytes += Illusion::File<uint8_t>(file).getContent().size();
+  }
+  print("sequential", bytes, getSeconds(start));
+
+  for (bool allowIoUring : {true, false}) {
+    Illusion::AsyncFileReader reader(queueDepth, allowIoUring);
+
+    start = std::chrono::steady_clock::now();
+    bytes = 0;
+    for (auto& future : reader.read(files)) {
+      bytes += future.get().size();
+    }
+
+    print(reader.getBackend() == Illusion::AsyncFileReader::Backend::eIoUring ? "io_uring"
+                                                                              : "thread pool",
+      bytes, getSeconds(start));
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Measures how long the calling thread is blocked by ILLUSION_DEBUG, with and without
+// Logger::enableAsync and with Logger::enableDebug set to false. The messages resemble the ones of
+// the Device. By default they are written to a file, pass --stdout 1 to print them to the
+// terminal. The total includes the final Logger::flush(). This does not require a Vulkan device.
+int benchmarkLogging(Arguments const& args) {
+  int  messages{getInt(args, "--messages", 100000)};
+  bool toStdout{getInt(args, "--stdout", 0) != 0};
+
+  std::string fileName{"benchmark.log"};
+  auto        oldSinks = Illusion::Logger::Sink::getAll();
+
+  std::vector<double> latencies(messages);
+  std::vector<double> results;
+
+  std::vector<std::string> modes{"sync", "async", "disabled"};
+
+  for (auto const& mode : modes) {
+    if (toStdout) {
+      Illusion::Logger::Sink::setAll({std::make_shared<Illusion::Logger::StdoutSink>()});
+    } else {
+      Illusion::Logger::Sink::setAll({std::make_shared<Illusion::Logger::FileSink>(fileName)});
+    }
+
+    Illusion::Logger::enableAsync = mode != "sync";
+    Illusion::Logger::enableDebug = mode != "disabled";
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i{0}; i < messages; ++i) {
+      auto call = std::chrono::steady_clock::now();
+      ILLUSION_DEBUG << "Creating Buffer " << i << "." << std::endl;
+      latencies[i] = getSeconds(call);
+    }
+    Illusion::Logger::flush();
+    double total{getSeconds(start)};
+
+    std::sort(latencies.begin(), latencies.end());
+    results.insert(results.end(), {total, latencies[messages / 2],
+                                    latencies[static_cast<size_t>(messages * 0.99)],
+                                    latencies.back()});
+  }
+
+  Illusion::Logger::Sink::setAll(oldSinks);
+  Illusion::Logger::enableAsync = true;
+  Illusion::Logger::enableDebug = true;
+  std::remove(fileName.c_str());
+
+  std::cout << "mode     | total ms | median us |  p99 us |   max us" << std::endl;
+
+  for (size_t i{0}; i < modes.size(); ++i) {
+    std::cout << std::setw(8) << std::left << modes[i] << std::right << " | " << std::setw(8)
+              << std::fixed << std::setprecision(2) << results[i * 4] * 1000.0 << " | "
+              << std::setw(9) << results[i * 4 + 1] * 1000000.0 << " | " << std::setw(7)
+              << results[i * 4 + 2] * 1000000.0 << " | " << std::setw(8)
+              << results[i * 4 + 3] * 1000000.0 << std::endl;
+  }
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Measures the overhead of ILLUSION_PROFILE_ZONE by entering --zones empty zones with the Profiler
+// disabled and enabled. The nested run opens four zones within each other per iteration. This
+// does not require a Vulkan device.
+int benchmarkProfiler(Arguments const& args) {
+  int zones{getInt(args, "--zones", 1000000)};
+
+  std::cout << "mode     | ns / zone" << std::endl;
+
+  auto print = [zones](std::string const& mode, double seconds) {
+    std::cout << std::setw(8) << std::left << mode << std::right << " | " << std::setw(9)
+              << std::fixed << std::setprecision(1) << seconds * 1000000000.0 / zones << std::endl;
+  };
+
+  Illusion::Profiler::enabled = false;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i{0}; i < zones; ++i) {
+    ILLUSION_PROFILE_ZONE("disabled");
+  }
+  print("disabled", getSeconds(start));
+
+  Illusion::Profiler::enabled = true;
+
+  start = std::chrono::steady_clock::now();
+  for (int i{0}; i < zones; ++i) {
+    ILLUSION_PROFILE_ZONE("enabled");
+  }
+  print("enabled", getSeconds(start));
+
+  start = std::chrono::steady_clock::now();
+  for (int i{0}; i < zones / 4; ++i) {
+    ILLUSION_PROFILE_ZONE("level 0");
+    ILLUSION_PROFILE_ZONE("level 1");
+    ILLUSION_PROFILE_ZONE("level 2");
+    ILLUSION_PROFILE_ZONE("level 3");
+  }
+  print("nested", getSeconds(start));
+
+  Illusion::Profiler::enabled = false;
+  Illusion::Profiler::clear();
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Creates count fences wrapped by the given function, copies each wrapper once with the given
+// function and destroys everything again. Prints the time per fence of each step.
+template <typename Wrap, typename Copy>
+void measureHandles(std::string const& name, vk::Device const& device, int count, Wrap wrap,
+  Copy copy) {
+
+  std::vector<decltype(wrap(vk::Fence()))> handles, copies;
+  handles.reserve(count);
+  copies.reserve(count);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i{0}; i < count; ++i) {
+    handles.push_back(wrap(device.createFence(vk::FenceCreateInfo())));
+  }
+  double create{getSeconds(start)};
+
+  start = std::chrono::steady_clock::now();
+  for (auto& handle : handles) {
+    copies.push_back(copy(handle));
+  }
+  double copying{getSeconds(start)};
+
+  start = std::chrono::steady_clock::now();
+  copies.clear();
+  handles.clear();
+  double destroy{getSeconds(start)};
+
+  std::cout << std::setw(13) << std::left << name << std::right << " | " << std::setw(9)
+            << std::fixed << std::setprecision(1) << create * 1000000000.0 / count << " | "
+            << std::setw(9) << copying * 1000000000.0 / count << " | " << std::setw(10)
+            << destroy * 1000000000.0 / count << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Compares the cost of creating, copying and destroying --count fences with different ownership
+// wrappers: a std::shared_ptr with a std::function deleter (the old makeVulkanPtr), the
+// single-allocation makeVulkanPtr for device objects and the move-only VulkanHandle, which is
+// moved instead of copied. "raw" creates and destroys the fences without any wrapper, this is the
+// cost of the driver alone. Debug messages are disabled while measuring.
+int benchmarkHandles(Arguments const& args) {
+  int count{getInt(args, "--count", 100000)};
+
+  auto instance = std::make_shared<Illusion::Graphics::Instance>("Benchmark", false, true);
+  auto device   = std::make_shared<Illusion::Graphics::Device>(instance);
+  auto vkDevice = device->getVkDevice();
+
+  Illusion::Logger::enableDebug = false;
+
+  std::cout << "wrapper       | create ns |   copy ns | destroy ns" << std::endl;
+
+  {
+    std::vector<vk::Fence> fences(count);
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto& fence : fences) {
+      fence = vkDevice->createFence(vk::FenceCreateInfo());
+    }
+    double create{getSeconds(start)};
+
+    start = std::chrono::steady_clock::now();
+    for (auto const& fence : fences) {
+      vkDevice->destroyFence(fence);
+    }
+    double destroy{getSeconds(start)};
+
+    std::cout << "raw           | " << std::setw(9) << std::fixed << std::setprecision(1)
+              << create * 1000000000.0 / count << " |         - | " << std::setw(10)
+              << destroy * 1000000000.0 / count << std::endl;
+  }
+
+  measureHandles("std::function", *vkDevice, count,
+    [&vkDevice](vk::Fence const& fence) {
+      auto device{vkDevice};
+      return Illusion::Graphics::makeVulkanPtr(
+        fence, [device](vk::Fence* obj) { device->destroyFence(*obj); });
+    },
+    [](Illusion::Graphics::VkFencePtr const& fence) { return fence; });
+
+  measureHandles("makeVulkanPtr", *vkDevice, count,
+    [&vkDevice](vk::Fence const& fence) {
+      return Illusion::Graphics::makeVulkanPtr(vkDevice, fence);
+    },
+    [](Illusion::Graphics::VkFencePtr const& fence) { return fence; });
+
+  measureHandles("VulkanHandle", *vkDevice, count,
+    [&vkDevice](vk::Fence const& fence) {
+      return Illusion::Graphics::VkFenceHandle(vkDevice, fence);
+    },
+    [](Illusion::Graphics::VkFenceHandle& fence) { return std::move(fence); });
+
+  Illusion::Logger::enableDebug = true;
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Loads --count textures and measures the time until the first frame has been rendered, once with
+// the blocking Texture constructor and once with a TextureStreamer which uploads at most
+// --budget-kb kilobytes per frame. Afterwards, frames are rendered until all streamed textures are
+// resident; the number of frames and the cost of TextureStreamer::update() are reported.
+int benchmarkStreaming(Arguments const& args) {
+  int  count{getInt(args, "--count", 16)};
+  int  budget{getInt(args, "--budget-kb", 4096)};
+  bool headless{getInt(args, "--headless", 0) != 0};
+
+  std::string fileName{"data/textures/box.dds"};
+
+  auto instance = std::make_shared<Illusion::Graphics::Instance>("Benchmark", false, headless);
+  auto device   = std::make_shared<Illusion::Graphics::Device>(instance);
+
+  Illusion::Graphics::WindowPtr  window;
+  Illusion::Graphics::SurfacePtr surface;
+
+  if (headless) {
+    surface = std::make_shared<Illusion::Graphics::Surface>(device, vk::Extent2D(800, 600), 2);
+  } else {
+    window = std::make_shared<Illusion::Graphics::Window>(device);
+    window->open(false, 2);
+    surface = window->getSurface();
+  }
+
+  auto renderFrame = [&](std::function<void()> const& beforeSubmit) {
+    if (window) { window->processInput(); }
+
+    auto frame = surface->beginFrame();
+    surface->beginRenderPass(frame);
+    surface->endRenderPass(frame);
+
+    if (beforeSubmit) { beforeSubmit(); }
+
+    surface->endFrame(frame);
+  };
+
+  // warm-up
+  for (int i{0}; i < 10; ++i) {
+    renderFrame(nullptr);
+  }
+
+  std::cout << "loader   | ms to first frame" << std::endl;
+
+  {
+    std::vector<Illusion::Graphics::TexturePtr> textures;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i{0}; i < count; ++i) {
+      textures.push_back(
+        std::make_shared<Illusion::Graphics::Texture>(device, fileName, vk::SamplerCreateInfo()));
+    }
+    renderFrame(nullptr);
+
+    std::cout << "blocking | " << std::setw(17) << std::fixed << std::setprecision(3)
+              << getSeconds(start) * 1000.0 << std::endl;
+
+    device->getVkDevice()->waitIdle();
+  }
+
+  auto jobSystem = std::make_shared<Illusion::JobSystem>();
+  auto streamer  = std::make_shared<Illusion::Graphics::TextureStreamer>(
+    device, jobSystem, static_cast<vk::DeviceSize>(budget) * 1024);
+
+  std::vector<Illusion::Graphics::StreamingTexturePtr> textures;
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i{0}; i < count; ++i) {
+    textures.push_back(streamer->load(fileName, vk::SamplerCreateInfo()));
+  }
+  renderFrame([&streamer]() { streamer->update(); });
+
+  std::cout << "streamed | " << std::setw(17) << std::fixed << std::setprecision(3)
+            << getSeconds(start) * 1000.0 << std::endl;
+
+  int      frames{1};
+  double   totalMilliseconds{streamer->getStatistics().mFrameMilliseconds};
+  double   maxMilliseconds{totalMilliseconds};
+  uint64_t maxBytes{streamer->getStatistics().mFrameBytes};
+
+  while (!streamer->isIdle()) {
+    renderFrame([&streamer]() { streamer->update(); });
+
+    auto const& statistics = streamer->getStatistics();
+    totalMilliseconds += statistics.mFrameMilliseconds;
+    maxMilliseconds = std::max(maxMilliseconds, statistics.mFrameMilliseconds);
+    maxBytes        = std::max(maxBytes, statistics.mFrameBytes);
+    ++frames;
+  }
+
+  device->getVkDevice()->waitIdle();
+
+  double decodeMilliseconds{0.0};
+  double residentMilliseconds{0.0};
+  for (auto const& texture : textures) {
+    decodeMilliseconds   = std::max(decodeMilliseconds, texture->getDecodeMilliseconds());
+    residentMilliseconds = std::max(residentMilliseconds, texture->getResidentMilliseconds());
+  }
+
+  std::cout << std::endl;
+  std::cout << "frames until resident: " << frames << std::endl;
+  std::cout << "longest decode:        " << decodeMilliseconds << " ms" << std::endl;
+  std::cout << "last resident after:   " << residentMilliseconds << " ms" << std::endl;
+  std::cout << "update() ms / frame:   " << totalMilliseconds / frames << " mean, "
+            << maxMilliseconds << " max" << std::endl;
+  std::cout << "uploaded:              " << streamer->getStatistics().mUploadedBytes / 1024
+            << " kB in " << streamer->getStatistics().mUploadedLevels << " levels, "
+            << maxBytes / 1024 << " kB max per frame" << std::endl;
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+  std::map<std::string, int (*)(Arguments const&)> benchmarks;
+  benchmarks["frames"]     = &benchmarkFrames;
+  benchmarks["handles"]    = &benchmarkHandles;
+  benchmarks["io"]         = &benchmarkIo;
+  benchmarks["jobs"]       = &benchmarkJobs;
+  benchmarks["logging"]    = &benchmarkLogging;
+  benchmarks["pipelines"]  = &benchmarkPipelines;
+  benchmarks["profiler"]   = &benchmarkProfiler;
+  benchmarks["queues"]     = &benchmarkQueues;
+  benchmarks["reflection"] = &benchmarkReflection;
+  benchmarks["streaming"]  = &benchmarkStreaming;
+
+  if (argc < 2 || benchmarks.find(argv[1]) == benchmarks.end()) {
+    std::cout << "Usage: " << argv[0] << " <benchmark> [--key value ...]" << std::endl;
+    std::cout << "Available benchmarks:" << std::endl;
+    for (auto const& benchmark : benchmarks) {
+      std::cout << "  " << benchmark.first << std::endl;
+    }
+    return 1;
+  }
+
+  Arguments args;
+  for (int i{2}; i + 1 < argc; i += 2) {
+    args[argv[i]] = argv[i + 1];
+  }
+
+  try {
+    return benchmarks[argv[1]](args);
+  } catch (std::runtime_error const& e) { ILLUSION_ERROR << e.what() << std::endl; }
+
+  return 1;
+}
@@ -15,6 +15,7 @@
 #include <VulkanPlayground/Graphics/Pipeline.hpp>
 #include <VulkanPlayground/Graphics/ShaderReflection.hpp>
 #include <VulkanPlayground/Graphics/Surface.hpp>
+#include <VulkanPlayground/Graphics/TextureCache.hpp>
 #include <VulkanPlayground/Graphics/TinyGLTF.hpp>
 #include <VulkanPlayground/Graphics/UniformBuffer.hpp>
 #include <VulkanPlayground/Graphics/Window.hpp>
@@ -37,14 +38,15 @@ struct Material {
 int main(int argc, char* argv[]) {
   try {
     auto instance{std::make_shared<Illusion::Graphics::Instance>("SimpleWindow")};
-    auto device{std::make_shared<Illusion::Graphics::Device>(instance)};
+    auto device{std::make_shared<Illusion::Graphics::Device>(
+      instance, "pipeline.cache", "reflection.cache")};
     auto window{std::make_shared<Illusion::Graphics::Window>(device)};
 
     // load the model ------------------------------------------------------------------------------
     tinygltf::Model model;
     {
       if (argc <= 1) {
-        Illusion::ILLUSION_ERROR << "Please provide a GLTF file." << std::endl;
+        ILLUSION_ERROR << "Please provide a GLTF file." << std::endl;
         return -1;
       }
 
@@ -55,19 +57,19 @@ int main(int argc, char* argv[]) {
       tinygltf::TinyGLTF loader;
 
       if (extension == ".glb" || extension == ".bin") {
-        Illusion::ILLUSION_MESSAGE << "Loading binary file " << file << "..." << std::endl;
+        ILLUSION_MESSAGE << "Loading binary file " << file << "..." << std::endl;
         success = loader.LoadBinaryFromFile(&model, &error, file);
 
       } else if (extension == ".gltf") {
-        Illusion::ILLUSION_MESSAGE << "Loading ascii file " << file << "..." << std::endl;
+        ILLUSION_MESSAGE << "Loading ascii file " << file << "..." << std::endl;
         success = loader.LoadASCIIFromFile(&model, &error, file);
       } else {
-        Illusion::ILLUSION_ERROR << "Unknown extension " << extension << std::endl;
+        ILLUSION_ERROR << "Unknown extension " << extension << std::endl;
         return -1;
       }
 
       if (!error.empty()) {
-        Illusion::ILLUSION_ERROR << "Error loading file " << file << ": " << error << std::endl;
+        ILLUSION_ERROR << "Error loading file " << file << ": " << error << std::endl;
       }
 
       if (!success) { return -1; }
@@ -85,6 +87,9 @@ int main(int argc, char* argv[]) {
       device, surface->getRenderPass(), shaderModules, 10)};
 
     // create the materials ------------------------------------------------------------------------
+    // materials often share their images, these are decoded and uploaded only once
+    auto textureCache{std::make_shared<Illusion::Graphics::TextureCache>(device)};
+
     std::vector<Material> materials;
 
     for (auto material : model.materials) {
@@ -102,33 +107,39 @@ int main(int argc, char* argv[]) {
         m.mBaseColorTexture = Illusion::Graphics::TinyGLTF::createTexture(
           device,
           model.samplers[model.textures[index].sampler],
-          model.images[model.textures[index].source]);
+          model.images[model.textures[index].source],
+          textureCache);
       }
       {
         int index{getTextureIndex(material.values, "metallicRoughnessTexture")};
         m.mMetallicRoughnessTexture = Illusion::Graphics::TinyGLTF::createTexture(
           device,
           model.samplers[model.textures[index].sampler],
-          model.images[model.textures[index].source]);
+          model.images[model.textures[index].source],
+          textureCache);
       }
       {
         int index{getTextureIndex(material.additionalValues, "normalTexture")};
         m.mNormalTexture = Illusion::Graphics::TinyGLTF::createTexture(
           device,
           model.samplers[model.textures[index].sampler],
-          model.images[model.textures[index].source]);
+          model.images[model.textures[index].source],
+          textureCache);
       }
       {
         int index{getTextureIndex(material.additionalValues, "occlusionTexture")};
         m.mOcclusionTexture = Illusion::Graphics::TinyGLTF::createTexture(
           device,
           model.samplers[model.textures[index].sampler],
-          model.images[model.textures[index].source]);
+          model.images[model.textures[index].source],
+          textureCache);
       }
 
       materials.push_back(m);
     }
 
+    textureCache->printStatistics();
+
     // while (!window->shouldClose()) {
     //   window->processInput();
 
@@ -141,7 +152,7 @@ int main(int argc, char* argv[]) {
 
     //   std::this_thread::sleep_for(std::chrono::milliseconds(5));
     // }
-  } catch (std::runtime_error const& e) { Illusion::ILLUSION_ERROR << e.what() << std::endl; }
+  } catch (std::runtime_error const& e) { ILLUSION_ERROR << e.what() << std::endl; }
 
   return 0;
 }
@@ -25,13 +25,25 @@
 
 int main(int argc, char* argv[]) {
   try {
-    auto instance = std::make_shared<Illusion::Graphics::Instance>("SimpleWindow");
-    auto device   = std::make_shared<Illusion::Graphics::Device>(instance);
-    auto window   = std::make_shared<Illusion::Graphics::Window>(device);
-
-    window->open(false);
+    // with --headless a fixed number of frames is rendered offscreen, no display is required
+    bool headless{argc > 1 && std::string(argv[1]) == "--headless"};
+
+    auto instance = std::make_shared<Illusion::Graphics::Instance>("SimpleWindow", true, headless);
+    auto device   = std::make_shared<Illusion::Graphics::Device>(
+      instance, "pipeline.cache", "reflection.cache");
+
+    Illusion::Graphics::WindowPtr  window;
+    Illusion::Graphics::SurfacePtr surface;
+
+    if (headless) {
+      surface = std::make_shared<Illusion::Graphics::Surface>(device, vk::Extent2D(800, 600));
+    } else {
+      window = std::make_shared<Illusion::Graphics::Window>(device);
+      window->open(false);
+      surface = window->getSurface();
+    }
 
-    auto surface = window->getSurface();
+    int remainingHeadlessFrames{300};
 
     std::vector<std::string> shader{"data/shaders/TexturedQuad.vert.spv",
                                     "data/shaders/TexturedQuad.frag.spv"};
@@ -50,8 +62,8 @@ int main(int argc, char* argv[]) {
     Reflection::TexturedQuad::PushConstants pushConstants;
     pushConstants.pos = glm::vec2(0.2, 0.5);
 
-    while (!window->shouldClose()) {
-      window->processInput();
+    while (headless ? remainingHeadlessFrames-- > 0 : !window->shouldClose()) {
+      if (window) { window->processInput(); }
 
       auto frame = surface->beginFrame();
       surface->beginRenderPass(frame);
@@ -65,12 +77,12 @@ int main(int argc, char* argv[]) {
       surface->endRenderPass(frame);
       surface->endFrame(frame);
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      if (!headless) { std::this_thread::sleep_for(std::chrono::milliseconds(10)); }
     }
 
     device->getVkDevice()->waitIdle();
 
-  } catch (std::runtime_error const& e) { Illusion::ILLUSION_ERROR << e.what() << std::endl; }
+  } catch (std::runtime_error const& e) { ILLUSION_ERROR << e.what() << std::endl; }
 
   return 0;
 }
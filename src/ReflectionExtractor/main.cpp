@@ -33,17 +33,15 @@ std::vector<std::string> splitString(std::string const& s, char delim) {
 int main(int argc, char* argv[]) {
 
   if (argc < 4) {
-    Illusion::ILLUSION_MESSAGE << "Usage:" << std::endl;
-    Illusion::ILLUSION_MESSAGE << "  ReflectionExtractor <SPIRV_FILE>"
-                               << " [<ADDITIONAL_SPIRV_FILES>] <NAMESPACE> <OUTPUT_HPP> "
-                               << std::endl;
-    Illusion::ILLUSION_MESSAGE << std::endl;
-    Illusion::ILLUSION_MESSAGE << "The ReflectionExtractor links together all provided spirv "
-                               << std::endl;
-    Illusion::ILLUSION_MESSAGE << "files and writes the resulting reflection header wrapped in a "
-                               << std::endl;
-    Illusion::ILLUSION_MESSAGE << "namespace <NAMESPACE> in the header file <OUTPUT_HPP>."
-                               << std::endl;
+    ILLUSION_MESSAGE << "Usage:" << std::endl;
+    ILLUSION_MESSAGE << "  ReflectionExtractor <SPIRV_FILE>"
+                     << " [<ADDITIONAL_SPIRV_FILES>] <NAMESPACE> <OUTPUT_HPP> "
+                     << std::endl;
+    ILLUSION_MESSAGE << std::endl;
+    ILLUSION_MESSAGE << "The ReflectionExtractor links together all provided spirv " << std::endl;
+    ILLUSION_MESSAGE << "files and writes the resulting reflection header wrapped in a "
+                     << std::endl;
+    ILLUSION_MESSAGE << "namespace <NAMESPACE> in the header file <OUTPUT_HPP>." << std::endl;
 
     return 0;
   }
@@ -92,7 +90,7 @@ int main(int argc, char* argv[]) {
     out << std::endl;
     out << "#endif // " + guard << std::endl;
 
-  } catch (std::runtime_error const& e) { Illusion::ILLUSION_ERROR << e.what() << std::endl; }
+  } catch (std::runtime_error const& e) { ILLUSION_ERROR << e.what() << std::endl; }
 
   return 0;
 }
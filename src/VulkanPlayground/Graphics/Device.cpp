@@ -13,11 +13,18 @@
 
 #include "../Utils/Logger.hpp"
 #include "Instance.hpp"
+#include "MemoryAllocator.hpp"
 #include "PhysicalDevice.hpp"
+#include "PipelineCache.hpp"
+#include "SamplerCache.hpp"
+#include "ShaderReflectionCache.hpp"
+#include "StagingRing.hpp"
+#include "UploadContext.hpp"
 #include "VulkanPtr.hpp"
 
 #include <GLFW/glfw3.h>
 
+#include <cstring>
 #include <iostream>
 #include <set>
 
@@ -25,18 +32,101 @@ namespace Illusion {
 namespace Graphics {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-Device::Device(InstancePtr const& instance)
+namespace {
+
+// all uploads are streamed through a ring of this size; larger uploads get a temporary buffer
+const vk::DeviceSize STAGING_RING_SIZE = 32 * 1024 * 1024;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class DeviceMemoryBackend : public MemoryAllocator::Backend {
+ public:
+  DeviceMemoryBackend(VkDevicePtr const& device)
+    : mDevice(device) {}
+
+  vk::DeviceMemory allocate(uint32_t memoryType, vk::DeviceSize size) override {
+    ILLUSION_DEBUG << "Allocating memory page." << std::endl;
+    vk::MemoryAllocateInfo info;
+    info.allocationSize  = size;
+    info.memoryTypeIndex = memoryType;
+    return mDevice->allocateMemory(info);
+  }
+
+  void free(vk::DeviceMemory const& memory) override {
+    ILLUSION_DEBUG << "Freeing memory page." << std::endl;
+    mDevice->freeMemory(memory);
+  }
+
+  void* map(vk::DeviceMemory const& memory, vk::DeviceSize size) override {
+    return mDevice->mapMemory(memory, 0, size);
+  }
+
+  void flush(vk::DeviceMemory const& memory, vk::DeviceSize offset, vk::DeviceSize size) override {
+    vk::MappedMemoryRange range;
+    range.memory = memory;
+    range.offset = offset;
+    range.size   = size;
+    mDevice->flushMappedMemoryRanges(range);
+  }
+
+ private:
+  VkDevicePtr mDevice;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Device::Device(
+  InstancePtr const& instance,
+  std::string const& pipelineCacheFile,
+  std::string const& reflectionCacheFile)
   : mInstance(instance)
   , mVkDevice(instance->createVkDevice())
   , mVkGraphicsQueue(mVkDevice->getQueue(mInstance->getGraphicsFamily(), 0))
   , mVkComputeQueue(mVkDevice->getQueue(mInstance->getComputeFamily(), 0))
-  , mVkPresentQueue(mVkDevice->getQueue(mInstance->getPresentFamily(), 0)) {
+  , mVkPresentQueue(mVkDevice->getQueue(mInstance->getPresentFamily(), 0))
+  , mVkTransferQueue(mVkDevice->getQueue(mInstance->getTransferFamily(), 0)) {
+
+  mMemoryAllocator = std::make_shared<MemoryAllocator>(
+    std::make_shared<DeviceMemoryBackend>(mVkDevice),
+    mInstance->getPhysicalDevice()->getMemoryProperties(),
+    mInstance->getPhysicalDevice()->getProperties().limits.bufferImageGranularity,
+    mInstance->getPhysicalDevice()->getProperties().limits.nonCoherentAtomSize);
 
   vk::CommandPoolCreateInfo info;
   info.queueFamilyIndex = mInstance->getGraphicsFamily();
   info.flags            = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
 
   mVkCommandPool = createVkCommandPool(info);
+
+  auto createStagingBuffer = [this](vk::DeviceSize size) {
+    return createMappedBuffer(
+      size,
+      vk::BufferUsageFlagBits::eTransferSrc,
+      vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+  };
+
+  mStagingRing = std::make_shared<StagingRing>(
+    mVkDevice, createStagingBuffer(STAGING_RING_SIZE), createStagingBuffer);
+
+  mUploadContext = std::make_shared<UploadContext>(
+    mVkDevice,
+    mStagingRing,
+    mVkTransferQueue,
+    mInstance->getTransferFamily(),
+    mVkGraphicsQueue,
+    mInstance->getGraphicsFamily(),
+    mQueueMutex);
+
+  mPipelineCache =
+    std::make_shared<PipelineCache>(mVkDevice, mInstance->getPhysicalDevice(), pipelineCacheFile);
+
+  mReflectionCache = std::make_shared<ShaderReflectionCache>(reflectionCacheFile);
+
+  mSamplerCache = std::make_shared<SamplerCache>(
+    mVkDevice, mInstance->getPhysicalDevice()->getProperties().limits.maxSamplerAllocationCount);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -45,6 +135,10 @@ Device::~Device() { mVkDevice->waitIdle(); }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+UploadTicket Device::flushUploads() const { return mUploadContext->submit(); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 vk::CommandBuffer Device::beginSingleTimeCommands() const {
   vk::CommandBufferAllocateInfo info;
   info.level              = vk::CommandBufferLevel::ePrimary;
@@ -70,8 +164,11 @@ void Device::endSingleTimeCommands(vk::CommandBuffer commandBuffer) const {
   info.commandBufferCount = 1;
   info.pCommandBuffers    = &commandBuffer;
 
-  mVkGraphicsQueue.submit(info, nullptr);
-  mVkGraphicsQueue.waitIdle();
+  {
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    mVkGraphicsQueue.submit(info, nullptr);
+    mVkGraphicsQueue.waitIdle();
+  }
 
   mVkDevice->freeCommandBuffers(*mVkCommandPool, commandBuffer);
 }
@@ -107,14 +204,13 @@ ImagePtr Device::createImage(
 
   auto requirements = mVkDevice->getImageMemoryRequirements(*result->mImage);
 
-  vk::MemoryAllocateInfo allocInfo;
-  allocInfo.allocationSize = requirements.size;
-  allocInfo.memoryTypeIndex =
-    mInstance->getPhysicalDevice()->findMemoryType(requirements.memoryTypeBits, properties);
-
-  result->mMemory = allocateMemory(allocInfo);
+  result->mMemory = mMemoryAllocator->allocate(
+    requirements,
+    properties,
+    tiling == vk::ImageTiling::eOptimal ? MemoryAllocator::ResourceType::eOptimal
+                                        : MemoryAllocator::ResourceType::eLinear);
 
-  mVkDevice->bindImageMemory(*result->mImage, *result->mMemory, 0);
+  mVkDevice->bindImageMemory(*result->mImage, result->mMemory->mMemory, result->mMemory->mOffset);
 
   return result;
 }
@@ -123,22 +219,14 @@ ImagePtr Device::createImage(
 
 VkBufferPtr Device::createVkBuffer(vk::BufferCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating buffer." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createBuffer(info), [device](vk::Buffer* obj) {
-    ILLUSION_DEBUG << "Deleting buffer." << std::endl;
-    device->destroyBuffer(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createBuffer(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkCommandPoolPtr Device::createVkCommandPool(vk::CommandPoolCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating command pool." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createCommandPool(info), [device](vk::CommandPool* obj) {
-    ILLUSION_DEBUG << "Deleting command pool." << std::endl;
-    device->destroyCommandPool(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createCommandPool(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -146,155 +234,104 @@ VkCommandPoolPtr Device::createVkCommandPool(vk::CommandPoolCreateInfo const& in
 VkDescriptorSetLayoutPtr
 Device::createVkDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating descriptor set layout." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(
-    device->createDescriptorSetLayout(info), [device](vk::DescriptorSetLayout* obj) {
-      ILLUSION_DEBUG << "Deleting descriptor set layout." << std::endl;
-      device->destroyDescriptorSetLayout(*obj);
-    });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createDescriptorSetLayout(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkDescriptorPoolPtr Device::createVkDescriptorPool(vk::DescriptorPoolCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating descriptor pool." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createDescriptorPool(info), [device](vk::DescriptorPool* obj) {
-    ILLUSION_DEBUG << "Deleting descriptor pool." << std::endl;
-    device->destroyDescriptorPool(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createDescriptorPool(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkDeviceMemoryPtr Device::allocateMemory(vk::MemoryAllocateInfo const& info) const {
   ILLUSION_DEBUG << "Allocating memory." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->allocateMemory(info), [device](vk::DeviceMemory* obj) {
-    ILLUSION_DEBUG << "Freeing memory." << std::endl;
-    device->freeMemory(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->allocateMemory(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkFramebufferPtr Device::createVkFramebuffer(vk::FramebufferCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating framebuffer." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createFramebuffer(info), [device](vk::Framebuffer* obj) {
-    ILLUSION_DEBUG << "Deleting framebuffer." << std::endl;
-    device->destroyFramebuffer(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createFramebuffer(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-VkFencePtr Device::createVkFence(vk::FenceCreateInfo const& info) const {
+VkFenceHandle Device::createVkFence(vk::FenceCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating fence." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createFence(info), [device](vk::Fence* obj) {
-    ILLUSION_DEBUG << "Deleting fence." << std::endl;
-    device->destroyFence(*obj);
-  });
+  return VkFenceHandle(mVkDevice, mVkDevice->createFence(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkImagePtr Device::createVkImage(vk::ImageCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating image." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createImage(info), [device](vk::Image* obj) {
-    ILLUSION_DEBUG << "Deleting image." << std::endl;
-    device->destroyImage(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createImage(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkImageViewPtr Device::createVkImageView(vk::ImageViewCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating image view." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createImageView(info), [device](vk::ImageView* obj) {
-    ILLUSION_DEBUG << "Deleting image view." << std::endl;
-    device->destroyImageView(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createImageView(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkPipelinePtr Device::createVkPipeline(vk::GraphicsPipelineCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating pipeline." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createGraphicsPipeline(nullptr, info), [device](vk::Pipeline* obj) {
-    ILLUSION_DEBUG << "Deleting pipeline." << std::endl;
-    device->destroyPipeline(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mPipelineCache->createGraphicsPipeline(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkPipelineLayoutPtr Device::createVkPipelineLayout(vk::PipelineLayoutCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating pipeline layout." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createPipelineLayout(info), [device](vk::PipelineLayout* obj) {
-    ILLUSION_DEBUG << "Deleting pipeline layout." << std::endl;
-    device->destroyPipelineLayout(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createPipelineLayout(info));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VkQueryPoolHandle Device::createVkQueryPool(vk::QueryPoolCreateInfo const& info) const {
+  ILLUSION_DEBUG << "Creating query pool." << std::endl;
+  return VkQueryPoolHandle(mVkDevice, mVkDevice->createQueryPool(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkRenderPassPtr Device::createVkRenderPass(vk::RenderPassCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating render pass." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createRenderPass(info), [device](vk::RenderPass* obj) {
-    ILLUSION_DEBUG << "Deleting render pass." << std::endl;
-    device->destroyRenderPass(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createRenderPass(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkSamplerPtr Device::createVkSampler(vk::SamplerCreateInfo const& info) const {
-  ILLUSION_DEBUG << "Creating sampler." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createSampler(info), [device](vk::Sampler* obj) {
-    ILLUSION_DEBUG << "Deleting sampler." << std::endl;
-    device->destroySampler(*obj);
-  });
+  return mSamplerCache->get(info);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-VkSemaphorePtr Device::createVkSemaphore(vk::SemaphoreCreateInfo const& info) const {
+VkSemaphoreHandle Device::createVkSemaphore(vk::SemaphoreCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating semaphore." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createSemaphore(info), [device](vk::Semaphore* obj) {
-    ILLUSION_DEBUG << "Deleting semaphore." << std::endl;
-    device->destroySemaphore(*obj);
-  });
+  return VkSemaphoreHandle(mVkDevice, mVkDevice->createSemaphore(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkShaderModulePtr Device::createVkShaderModule(vk::ShaderModuleCreateInfo const& info) const {
   ILLUSION_DEBUG << "Creating shader module." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createShaderModule(info), [device](vk::ShaderModule* obj) {
-    ILLUSION_DEBUG << "Deleting shader module." << std::endl;
-    device->destroyShaderModule(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createShaderModule(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkSwapchainKHRPtr Device::createVkSwapChainKhr(vk::SwapchainCreateInfoKHR const& info) const {
   ILLUSION_DEBUG << "Creating swap chain." << std::endl;
-  auto device{mVkDevice};
-  return makeVulkanPtr(device->createSwapchainKHR(info), [device](vk::SwapchainKHR* obj) {
-    ILLUSION_DEBUG << "Deleting swap chain." << std::endl;
-    device->destroySwapchainKHR(*obj);
-  });
+  return makeVulkanPtr(mVkDevice, mVkDevice->createSwapchainKHR(info));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -305,34 +342,32 @@ BufferPtr Device::createBuffer(
   vk::MemoryPropertyFlags properties,
   void*                   data) const {
 
-  auto result = std::make_shared<Buffer>();
+  auto result   = std::make_shared<Buffer>();
+  result->mSize = size;
+
+  bool needsStaging = data && !(properties & vk::MemoryPropertyFlagBits::eHostVisible);
 
   {
     vk::BufferCreateInfo info;
     info.size        = size;
-    info.usage       = usage;
+    info.usage       = needsStaging ? usage | vk::BufferUsageFlagBits::eTransferDst : usage;
     info.sharingMode = vk::SharingMode::eExclusive;
 
     result->mBuffer = createVkBuffer(info);
   }
 
-  {
-    auto requirements = mVkDevice->getBufferMemoryRequirements(*result->mBuffer);
-
-    vk::MemoryAllocateInfo info;
-    info.allocationSize = requirements.size;
-    info.memoryTypeIndex =
-      mInstance->getPhysicalDevice()->findMemoryType(requirements.memoryTypeBits, properties);
+  auto requirements = mVkDevice->getBufferMemoryRequirements(*result->mBuffer);
 
-    result->mMemory = allocateMemory(info);
-  }
+  result->mMemory =
+    mMemoryAllocator->allocate(requirements, properties, MemoryAllocator::ResourceType::eLinear);
 
-  mVkDevice->bindBufferMemory(*result->mBuffer, *result->mMemory, 0);
+  mVkDevice->bindBufferMemory(*result->mBuffer, result->mMemory->mMemory, result->mMemory->mOffset);
 
-  if (data) {
-    void* dst = mVkDevice->mapMemory(*result->mMemory, 0, size);
-    std::memcpy(dst, data, size);
-    mVkDevice->unmapMemory(*result->mMemory);
+  if (needsStaging) {
+    mUploadContext->uploadBuffer(result, size, data);
+  } else if (data) {
+    std::memcpy(mMemoryAllocator->map(*result->mMemory), data, size);
+    mMemoryAllocator->flush(*result->mMemory, 0, size);
   }
 
   return result;
@@ -340,45 +375,20 @@ BufferPtr Device::createBuffer(
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Device::transitionImageLayout(
-  VkImagePtr&               image,
-  vk::ImageLayout           oldLayout,
-  vk::ImageLayout           newLayout,
-  vk::ImageSubresourceRange subresourceRange) const {
+BufferPtr Device::createMappedBuffer(
+  vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties) const {
 
-  vk::CommandBuffer commandBuffer = beginSingleTimeCommands();
+  auto result = createBuffer(size, usage, properties | vk::MemoryPropertyFlagBits::eHostVisible);
+  result->mMappedData = static_cast<uint8_t*>(mMemoryAllocator->map(*result->mMemory));
 
-  vk::ImageMemoryBarrier barrier;
-  barrier.oldLayout           = oldLayout;
-  barrier.newLayout           = newLayout;
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image               = *image;
-  barrier.subresourceRange    = subresourceRange;
-
-  vk::PipelineStageFlags sourceStage;
-  vk::PipelineStageFlags destinationStage;
-
-  if (
-    oldLayout == vk::ImageLayout::eUndefined && newLayout == vk::ImageLayout::eTransferDstOptimal) {
-    barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-    sourceStage           = vk::PipelineStageFlagBits::eTopOfPipe;
-    destinationStage      = vk::PipelineStageFlagBits::eTransfer;
-  } else if (
-    oldLayout == vk::ImageLayout::eTransferDstOptimal &&
-    newLayout == vk::ImageLayout::eShaderReadOnlyOptimal) {
-    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-    sourceStage           = vk::PipelineStageFlagBits::eTransfer;
-    destinationStage      = vk::PipelineStageFlagBits::eFragmentShader;
-  } else {
-    ILLUSION_ERROR << "Requested an unsupported layout transition!" << std::endl;
-  }
+  return result;
+}
 
-  commandBuffer.pipelineBarrier(
-    sourceStage, destinationStage, vk::DependencyFlagBits(), nullptr, nullptr, barrier);
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  endSingleTimeCommands(commandBuffer);
+void Device::flushBuffer(
+  BufferPtr const& buffer, vk::DeviceSize offset, vk::DeviceSize size) const {
+  mMemoryAllocator->flush(*buffer->mMemory, offset, size);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
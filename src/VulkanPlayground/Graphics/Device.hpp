@@ -12,7 +12,12 @@
 #define ILLUSION_GRAPHICS_DEVICE_HPP
 
 // ---------------------------------------------------------------------------------------- includes
+#include "../Utils/Span.hpp"
 #include "../fwd.hpp"
+#include "UploadContext.hpp"
+#include "VulkanHandle.hpp"
+
+#include <mutex>
 
 namespace Illusion {
 namespace Graphics {
@@ -21,13 +26,28 @@ namespace Graphics {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 struct Image {
-  VkImagePtr        mImage;
-  VkDeviceMemoryPtr mMemory;
+  VkImagePtr          mImage;
+  MemoryAllocationPtr mMemory;
 };
 
 struct Buffer {
-  VkBufferPtr       mBuffer;
-  VkDeviceMemoryPtr mMemory;
+  VkBufferPtr         mBuffer;
+  MemoryAllocationPtr mMemory;
+  vk::DeviceSize      mSize{0};
+
+  // only set for buffers created with Device::createMappedBuffer(); the pointer stays valid for the
+  // entire lifetime of the buffer
+  uint8_t* mMappedData{nullptr};
+
+  // Returns a typed view onto the mapped memory, starting offset bytes into the buffer. Writes to
+  // non-coherent memory have to be made visible with Device::flushBuffer(). Throws a
+  // std::runtime_error if the offset lies beyond the end of the buffer.
+  template <typename T>
+  Span<T> getMappedSpan(vk::DeviceSize offset = 0) const {
+    if (!mMappedData) { throw std::runtime_error{"Buffer is not persistently mapped!"}; }
+    if (offset > mSize) { throw std::runtime_error{"Offset exceeds the size of the buffer!"}; }
+    return Span<T>(reinterpret_cast<T*>(mMappedData + offset), (mSize - offset) / sizeof(T));
+  }
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -35,7 +55,13 @@ class Device {
 
  public:
   // -------------------------------------------------------------------------------- public methods
-  Device(InstancePtr const& instance);
+  // The pipeline cache and the shader reflection cache are loaded from the given files and written
+  // back when the device is destroyed. If a file name is empty, which is the default, the
+  // respective cache is kept in memory only.
+  Device(
+    InstancePtr const& instance,
+    std::string const& pipelineCacheFile   = "",
+    std::string const& reflectionCacheFile = "");
   ~Device();
 
   vk::CommandBuffer beginSingleTimeCommands() const;
@@ -50,43 +76,72 @@ class Device {
     vk::ImageUsageFlags     usage,
     vk::MemoryPropertyFlags properties) const;
 
+  // If data is given and the memory is not host visible, the upload is recorded to the
+  // UploadContext; eTransferDst is added to the usage flags in this case. The data may be released
+  // right after this call.
   BufferPtr createBuffer(
     vk::DeviceSize          size,
     vk::BufferUsageFlags    usage,
     vk::MemoryPropertyFlags properties,
     void*                   data = nullptr) const;
 
+  // Creates a buffer in host visible memory which stays mapped for its entire lifetime. Per-frame
+  // updates are then plain writes to Buffer::getMappedSpan() without any driver calls (apart from
+  // flushBuffer() for non-coherent memory).
+  BufferPtr createMappedBuffer(
+    vk::DeviceSize          size,
+    vk::BufferUsageFlags    usage,
+    vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eHostVisible) const;
+
+  // Makes host writes to the given byte range visible to the device. This is a no-op for host
+  // coherent memory.
+  void flushBuffer(
+    BufferPtr const& buffer, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE) const;
+
+  // Fences, semaphores and query pools usually have a single owner, hence they are returned as
+  // move-only handles. Use VulkanHandle::share() if they need to be shared. Samplers are shared
+  // through the SamplerCache: equal create infos return the same sampler.
   VkBufferPtr         createVkBuffer(vk::BufferCreateInfo const&) const;
   VkCommandPoolPtr    createVkCommandPool(vk::CommandPoolCreateInfo const&) const;
   VkDescriptorPoolPtr createVkDescriptorPool(vk::DescriptorPoolCreateInfo const&) const;
   VkDescriptorSetLayoutPtr
                       createVkDescriptorSetLayout(vk::DescriptorSetLayoutCreateInfo const&) const;
   VkDeviceMemoryPtr   allocateMemory(vk::MemoryAllocateInfo const&) const;
-  VkFencePtr          createVkFence(vk::FenceCreateInfo const&) const;
+  VkFenceHandle       createVkFence(vk::FenceCreateInfo const&) const;
   VkFramebufferPtr    createVkFramebuffer(vk::FramebufferCreateInfo const&) const;
   VkImagePtr          createVkImage(vk::ImageCreateInfo const&) const;
   VkImageViewPtr      createVkImageView(vk::ImageViewCreateInfo const&) const;
   VkPipelineLayoutPtr createVkPipelineLayout(vk::PipelineLayoutCreateInfo const&) const;
   VkPipelinePtr       createVkPipeline(vk::GraphicsPipelineCreateInfo const&) const;
+  VkQueryPoolHandle   createVkQueryPool(vk::QueryPoolCreateInfo const&) const;
   VkRenderPassPtr     createVkRenderPass(vk::RenderPassCreateInfo const&) const;
   VkSamplerPtr        createVkSampler(vk::SamplerCreateInfo const&) const;
-  VkSemaphorePtr      createVkSemaphore(vk::SemaphoreCreateInfo const&) const;
+  VkSemaphoreHandle   createVkSemaphore(vk::SemaphoreCreateInfo const&) const;
   VkShaderModulePtr   createVkShaderModule(vk::ShaderModuleCreateInfo const&) const;
   VkSwapchainKHRPtr   createVkSwapChainKhr(vk::SwapchainCreateInfoKHR const&) const;
 
-  void transitionImageLayout(
-    VkImagePtr&     image,
-    vk::ImageLayout oldLayout,
-    vk::ImageLayout newLayout,
-    vk::ImageSubresourceRange) const;
+  InstancePtr const&              getInstance() const { return mInstance; }
+  MemoryAllocatorPtr const&       getMemoryAllocator() const { return mMemoryAllocator; }
+  StagingRingPtr const&           getStagingRing() const { return mStagingRing; }
+  UploadContextPtr const&         getUploadContext() const { return mUploadContext; }
+  PipelineCachePtr const&         getPipelineCache() const { return mPipelineCache; }
+  ShaderReflectionCachePtr const& getShaderReflectionCache() const { return mReflectionCache; }
+  SamplerCachePtr const&          getSamplerCache() const { return mSamplerCache; }
 
-  InstancePtr const& getInstance() const { return mInstance; }
+  // Submits all uploads which have been recorded to the UploadContext so far. This is called by the
+  // Surface before each frame is submitted, but it may be called from any thread.
+  UploadTicket flushUploads() const;
 
   VkDevicePtr const&      getVkDevice() const { return mVkDevice; }
   VkCommandPoolPtr const& getVkCommandPool() const { return mVkCommandPool; }
   vk::Queue const&        getVkGraphicsQueue() const { return mVkGraphicsQueue; }
   vk::Queue const&        getVkComputeQueue() const { return mVkComputeQueue; }
   vk::Queue const&        getVkPresentQueue() const { return mVkPresentQueue; }
+  vk::Queue const&        getVkTransferQueue() const { return mVkTransferQueue; }
+
+  // The UploadContext may submit from any thread. Therefore this has to be locked for all
+  // submissions to the queues above and for presentation.
+  std::mutex& getQueueMutex() const { return mQueueMutex; }
 
  private:
   // ------------------------------------------------------------------------------- private methods
@@ -95,9 +150,16 @@ class Device {
   // ------------------------------------------------------------------------------- private members
   InstancePtr mInstance;
 
-  VkDevicePtr      mVkDevice;
-  vk::Queue        mVkGraphicsQueue, mVkComputeQueue, mVkPresentQueue;
-  VkCommandPoolPtr mVkCommandPool;
+  VkDevicePtr              mVkDevice;
+  MemoryAllocatorPtr       mMemoryAllocator;
+  vk::Queue                mVkGraphicsQueue, mVkComputeQueue, mVkPresentQueue, mVkTransferQueue;
+  mutable std::mutex       mQueueMutex;
+  VkCommandPoolPtr         mVkCommandPool;
+  StagingRingPtr           mStagingRing;
+  UploadContextPtr         mUploadContext;
+  PipelineCachePtr         mPipelineCache;
+  ShaderReflectionCachePtr mReflectionCache;
+  SamplerCachePtr          mSamplerCache;
 };
 }
 }
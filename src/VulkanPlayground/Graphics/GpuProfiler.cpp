@@ -0,0 +1,202 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "GpuProfiler.hpp"
+
+#include "../Utils/Logger.hpp"
+#include "Device.hpp"
+#include "Instance.hpp"
+#include "PhysicalDevice.hpp"
+
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GpuProfiler::GpuProfiler(
+  DevicePtr const& device, uint32_t framesInFlight, uint32_t maxZonesPerFrame)
+  : mDevice(device)
+  , mMaxQueries(2 + 2 * maxZonesPerFrame)
+  , mFrames(framesInFlight) {
+
+  auto const& physicalDevice = mDevice->getInstance()->getPhysicalDevice();
+  auto        properties     = physicalDevice->getProperties();
+  auto        families       = physicalDevice->getQueueFamilyProperties();
+  uint32_t    validBits{families[mDevice->getInstance()->getGraphicsFamily()].timestampValidBits};
+
+  if (!properties.limits.timestampComputeAndGraphics || validBits == 0) {
+    ILLUSION_WARNING << "Timestamp queries are not supported, GPU zones will not be measured."
+                     << std::endl;
+    return;
+  }
+
+  mTimestampPeriod = properties.limits.timestampPeriod;
+  mTimestampMask   = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+  vk::QueryPoolCreateInfo info;
+  info.queryType  = vk::QueryType::eTimestamp;
+  info.queryCount = mMaxQueries;
+
+  for (auto& frame : mFrames) {
+    frame.mPool = mDevice->createVkQueryPool(info);
+  }
+
+  info.queryCount  = 1;
+  mCalibrationPool = mDevice->createVkQueryPool(info);
+
+  mTrack = Profiler::createTrack("GPU");
+
+  calibrate();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+GpuProfiler::~GpuProfiler() {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GpuProfiler::beginFrame(vk::CommandBuffer const& commandBuffer, uint32_t frameIndex) {
+  if (!isSupported()) { return; }
+
+  mCurrentFrame = &mFrames[frameIndex];
+
+  if (mCurrentFrame->mIsRecorded) { readBack(*mCurrentFrame); }
+
+  mCurrentFrame->mZones.clear();
+  mCurrentFrame->mQueryCount  = 2;
+  mCurrentFrame->mFrameNumber = mFrameCount++;
+  mCurrentFrame->mIsRecorded  = true;
+  mCurrentDepth               = 0;
+
+  commandBuffer.resetQueryPool(*mCurrentFrame->mPool, 0, mMaxQueries);
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *mCurrentFrame->mPool, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GpuProfiler::endFrame(vk::CommandBuffer const& commandBuffer) {
+  if (!mCurrentFrame) { return; }
+
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *mCurrentFrame->mPool, 1);
+
+  mCurrentFrame = nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t GpuProfiler::beginZone(
+  vk::CommandBuffer const& commandBuffer, const char* name, vk::PipelineStageFlagBits stage) {
+
+  if (!mCurrentFrame || mCurrentFrame->mQueryCount + 2 > mMaxQueries) { return ~0u; }
+
+  uint32_t query{mCurrentFrame->mQueryCount};
+  mCurrentFrame->mQueryCount += 2;
+  mCurrentFrame->mZones.push_back({name, mCurrentDepth++, query, query + 1});
+
+  commandBuffer.writeTimestamp(stage, *mCurrentFrame->mPool, query);
+
+  return static_cast<uint32_t>(mCurrentFrame->mZones.size() - 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GpuProfiler::endZone(
+  vk::CommandBuffer const& commandBuffer, uint32_t zone, vk::PipelineStageFlagBits stage) {
+
+  if (!mCurrentFrame || zone >= mCurrentFrame->mZones.size()) { return; }
+
+  --mCurrentDepth;
+
+  commandBuffer.writeTimestamp(stage, *mCurrentFrame->mPool, mCurrentFrame->mZones[zone].mEndQuery);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GpuProfiler::calibrate() {
+  if (!isSupported()) { return; }
+
+  auto const& pool = mCalibrationPool;
+
+  vk::CommandBuffer commandBuffer{mDevice->beginSingleTimeCommands()};
+  commandBuffer.resetQueryPool(*pool, 0, 1);
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *pool, 0);
+
+  // the timestamp is taken somewhere between submission and the return of waitIdle()
+  uint64_t before{Profiler::now()};
+  mDevice->endSingleTimeCommands(commandBuffer);
+  uint64_t after{Profiler::now()};
+
+  uint64_t ticks{0};
+  mDevice->getVkDevice()->getQueryPoolResults(*pool, 0, 1, sizeof(uint64_t), &ticks,
+    sizeof(uint64_t), vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+
+  mCpuOffset = static_cast<int64_t>(before + (after - before) / 2) -
+               static_cast<int64_t>((ticks & mTimestampMask) * mTimestampPeriod);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void GpuProfiler::readBack(FrameQueries& frame) {
+  std::vector<uint64_t> ticks(frame.mQueryCount);
+
+  // the frame has finished, so this does not block
+  auto result = mDevice->getVkDevice()->getQueryPoolResults(*frame.mPool, 0, frame.mQueryCount,
+    ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t),
+    vk::QueryResultFlagBits::e64);
+
+  mLastFrame.mFrameNumber = frame.mFrameNumber;
+  mLastFrame.mIsValid     = result == vk::Result::eSuccess;
+  mLastFrame.mZones.clear();
+
+  if (!mLastFrame.mIsValid) {
+    ILLUSION_DEBUG << "Results of GPU frame " << frame.mFrameNumber << " are not available."
+                   << std::endl;
+    return;
+  }
+
+  auto toMilliseconds = [this](uint64_t start, uint64_t end) {
+    return ((end - start) & mTimestampMask) * mTimestampPeriod * 0.000001;
+  };
+
+  mLastFrame.mMilliseconds = toMilliseconds(ticks[0], ticks[1]);
+
+  for (auto const& pending : frame.mZones) {
+    Zone zone;
+    zone.mName                 = pending.mName;
+    zone.mDepth                = pending.mDepth;
+    zone.mStartMilliseconds    = toMilliseconds(ticks[0], ticks[pending.mBeginQuery]);
+    zone.mDurationMilliseconds =
+      toMilliseconds(ticks[pending.mBeginQuery], ticks[pending.mEndQuery]);
+    mLastFrame.mZones.push_back(zone);
+  }
+
+  if (Profiler::enabled) {
+    Profiler::record(mTrack, "Frame", toCpuTime(ticks[0]), toCpuTime(ticks[1]));
+
+    for (auto const& pending : frame.mZones) {
+      Profiler::record(mTrack, pending.mName, toCpuTime(ticks[pending.mBeginQuery]),
+        toCpuTime(ticks[pending.mEndQuery]));
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t GpuProfiler::toCpuTime(uint64_t ticks) const {
+  return static_cast<uint64_t>(
+    static_cast<int64_t>((ticks & mTimestampMask) * mTimestampPeriod) + mCpuOffset);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
@@ -0,0 +1,170 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_GPU_PROFILER_HPP
+#define ILLUSION_GRAPHICS_GPU_PROFILER_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../Utils/Profiler.hpp"
+#include "../fwd.hpp"
+#include "VulkanHandle.hpp"
+
+#include <vector>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Measures named zones of command buffers with timestamp queries. There is one query pool per    //
+// frame in flight; the results of a frame are read back when its pool is reused, that is after   //
+// the Surface has waited for the fence of that frame. Hence reading never stalls, and the        //
+// results are framesInFlight frames old. The timestamps are converted to milliseconds with the   //
+// timestampPeriod of the device. If the Profiler is enabled, the zones are also recorded to a    //
+// "GPU" track of the Profiler, so they can be inspected next to the CPU zones. For this, the GPU //
+// clock is related to the steady clock once on construction (see calibrate()); the accuracy of   //
+// this is in the order of a queue submission.                                                    //
+// The Surface owns a GpuProfiler and calls beginFrame() and endFrame().                          //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class GpuProfiler {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  struct Zone {
+    const char* mName{nullptr};
+    uint32_t    mDepth{0};
+
+    // relative to the start of the frame
+    double mStartMilliseconds{0.0};
+    double mDurationMilliseconds{0.0};
+  };
+
+  struct Frame {
+    // counts the calls to beginFrame(), starting at 0
+    uint64_t mFrameNumber{0};
+
+    // false if the results were not available or the timestamps are not supported
+    bool mIsValid{false};
+
+    double            mMilliseconds{0.0};
+    std::vector<Zone> mZones;
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  // Each frame may contain up to maxZonesPerFrame zones, further zones are ignored.
+  GpuProfiler(DevicePtr const& device, uint32_t framesInFlight, uint32_t maxZonesPerFrame = 128);
+  virtual ~GpuProfiler();
+
+  // False if the graphics queue does not support timestamps. All methods do nothing in this case.
+  bool isSupported() const { return mTimestampPeriod > 0.0; }
+
+  // Has to be called right after the command buffer has been begun, outside of any render pass.
+  // The frame which used the given frameIndex before must have finished execution already.
+  void beginFrame(vk::CommandBuffer const& commandBuffer, uint32_t frameIndex);
+
+  // Has to be called right before the command buffer is ended.
+  void endFrame(vk::CommandBuffer const& commandBuffer);
+
+  // The name has to stay valid until the program exits, see Profiler::intern(). The returned
+  // value has to be passed to endZone().
+  uint32_t beginZone(
+    vk::CommandBuffer const&  commandBuffer,
+    const char*               name,
+    vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eTopOfPipe);
+  void endZone(
+    vk::CommandBuffer const&  commandBuffer,
+    uint32_t                  zone,
+    vk::PipelineStageFlagBits stage = vk::PipelineStageFlagBits::eBottomOfPipe);
+
+  // The most recent frame whose results have been read back.
+  Frame const& getLastFrame() const { return mLastFrame; }
+
+  // Relates the GPU clock to the steady clock of the Profiler. This waits for the graphics queue
+  // to become idle. As the clocks may drift apart, it can be called again from time to time.
+  void calibrate();
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct PendingZone {
+    const char* mName;
+    uint32_t    mDepth;
+    uint32_t    mBeginQuery;
+    uint32_t    mEndQuery;
+  };
+
+  struct FrameQueries {
+    VkQueryPoolHandle        mPool;
+    std::vector<PendingZone> mZones;
+    uint32_t                 mQueryCount{0};
+    uint64_t                 mFrameNumber{0};
+    bool                     mIsRecorded{false};
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  void readBack(FrameQueries& frame);
+
+  // converts a timestamp to nanoseconds of the steady clock
+  uint64_t toCpuTime(uint64_t ticks) const;
+
+  // ------------------------------------------------------------------------------- private members
+  DevicePtr mDevice;
+  uint32_t  mMaxQueries;
+  double    mTimestampPeriod{0.0};
+  uint64_t  mTimestampMask{~0ull};
+
+  // steady clock nanoseconds minus GPU nanoseconds
+  int64_t mCpuOffset{0};
+
+  std::vector<FrameQueries> mFrames;
+  VkQueryPoolHandle         mCalibrationPool;
+  FrameQueries*             mCurrentFrame{nullptr};
+  uint32_t                  mCurrentDepth{0};
+  uint64_t                  mFrameCount{0};
+
+  Frame            mLastFrame;
+  Profiler::Track* mTrack{nullptr};
+};
+
+// -------------------------------------------------------------------------------------------------
+// Measures the commands recorded between its construction and destruction.
+class GpuProfilerZone {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  GpuProfilerZone(
+    GpuProfilerPtr const& profiler, vk::CommandBuffer const& commandBuffer, const char* name)
+    : mProfiler(profiler)
+    , mCommandBuffer(commandBuffer)
+    , mZone(profiler->beginZone(commandBuffer, name)) {}
+
+  ~GpuProfilerZone() { mProfiler->endZone(mCommandBuffer, mZone); }
+
+  GpuProfilerZone(GpuProfilerZone const& other) = delete;
+  GpuProfilerZone& operator=(GpuProfilerZone const& other) = delete;
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  GpuProfilerPtr    mProfiler;
+  vk::CommandBuffer mCommandBuffer;
+  uint32_t          mZone;
+};
+}
+}
+
+// ------------------------------------------------------------------------------------------ macros
+// Use this macro in your code like this:
+//   ILLUSION_GPU_PROFILE_ZONE(surface->getGpuProfiler(), info.mPrimaryCommandBuffer, "Shadows");
+// The zone ends with the enclosing scope.
+#define ILLUSION_GPU_PROFILE_ZONE(profiler, commandBuffer, name)                                   \
+  ::Illusion::Graphics::GpuProfilerZone ILLUSION_PROFILE_CONCAT(illusionGpuZone, __LINE__)(        \
+    profiler, commandBuffer, name)
+
+#endif // ILLUSION_GRAPHICS_GPU_PROFILER_HPP
@@ -19,7 +19,6 @@
 
 #include <iostream>
 #include <set>
-#include <sstream>
 
 namespace Illusion {
 namespace Graphics {
@@ -48,15 +47,13 @@ VkBool32 messageCallback(
   const char*                message,
   void*                      userData) {
 
-  std::stringstream buf;
-  buf << "[" << layer << "] " << message << " (code: " << code << ")" << std::endl;
-
+  // the message is only formatted if the corresponding level is enabled
   if (flags & VK_DEBUG_REPORT_ERROR_BIT_EXT) {
-    ILLUSION_ERROR << buf.str();
+    ILLUSION_ERROR << "[" << layer << "] " << message << " (code: " << code << ")" << std::endl;
   } else if (flags & VK_DEBUG_REPORT_WARNING_BIT_EXT) {
-    ILLUSION_WARNING << buf.str();
+    ILLUSION_WARNING << "[" << layer << "] " << message << " (code: " << code << ")" << std::endl;
   } else if (flags & VK_DEBUG_REPORT_PERFORMANCE_WARNING_BIT_EXT) {
-    ILLUSION_DEBUG << buf.str();
+    ILLUSION_DEBUG << "[" << layer << "] " << message << " (code: " << code << ")" << std::endl;
   }
 
   return false;
@@ -78,6 +75,33 @@ int chooseQueueFamily(vk::PhysicalDevice const& physicalDevice, vk::QueueFlagBit
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Returns a family which supports transfer but neither graphics nor compute if there is one. Else
+// a family without graphics support is searched. Returns -1 if there is no such family; the
+// graphics family should be used for transfers in this case.
+int chooseTransferQueueFamily(vk::PhysicalDevice const& physicalDevice) {
+  auto queueFamilies = physicalDevice.getQueueFamilyProperties();
+
+  int fallback{-1};
+
+  for (size_t i{0}; i < queueFamilies.size(); ++i) {
+    auto flags = queueFamilies[i].queueFlags;
+
+    if (
+      queueFamilies[i].queueCount == 0 || !(flags & vk::QueueFlagBits::eTransfer) ||
+      (flags & vk::QueueFlagBits::eGraphics)) {
+      continue;
+    }
+
+    if (!(flags & vk::QueueFlagBits::eCompute)) { return i; }
+
+    if (fallback < 0) { fallback = i; }
+  }
+
+  return fallback;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 int choosePresentQueueFamily(
   vk::PhysicalDevice const& physicalDevice, vk::Instance const& instance) {
   auto queueFamilies = physicalDevice.getQueueFamilyProperties();
@@ -114,13 +138,16 @@ bool checkValidationLayerSupport() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-std::vector<const char*> getRequiredInstanceExtensions(bool debugMode) {
-  unsigned int glfwExtensionCount{0};
-  const char** glfwExtensions{glfwGetRequiredInstanceExtensions(&glfwExtensionCount)};
-
+std::vector<const char*> getRequiredInstanceExtensions(bool debugMode, bool headless) {
   std::vector<const char*> extensions;
-  for (unsigned int i = 0; i < glfwExtensionCount; ++i) {
-    extensions.push_back(glfwExtensions[i]);
+
+  if (!headless) {
+    unsigned int glfwExtensionCount{0};
+    const char** glfwExtensions{glfwGetRequiredInstanceExtensions(&glfwExtensionCount)};
+
+    for (unsigned int i = 0; i < glfwExtensionCount; ++i) {
+      extensions.push_back(glfwExtensions[i]);
+    }
   }
 
   if (debugMode) { extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME); }
@@ -128,15 +155,23 @@ std::vector<const char*> getRequiredInstanceExtensions(bool debugMode) {
   return extensions;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// a headless instance never creates a swap chain
+std::vector<const char*> getRequiredDeviceExtensions(bool headless) {
+  return headless ? std::vector<const char*>() : DEVICE_EXTENSIONS;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-Instance::Instance(std::string const& appName, bool debugMode)
-  : mDebugMode(debugMode) {
+Instance::Instance(std::string const& appName, bool debugMode, bool headless)
+  : mDebugMode(debugMode)
+  , mHeadless(headless) {
 
-  if (!glfwInitialized) {
+  if (!mHeadless && !glfwInitialized) {
     if (!glfwInit()) { throw std::runtime_error{"Failed to initialize GLFW."}; }
 
     glfwSetErrorCallback([](int error, const char* description) {
@@ -167,7 +202,7 @@ void Instance::createInstance(std::string const& engineName, std::string const&
   appInfo.apiVersion         = VK_API_VERSION_1_0;
 
   // find required extensions
-  auto extensions(getRequiredInstanceExtensions(mDebugMode));
+  auto extensions(getRequiredInstanceExtensions(mDebugMode, mHeadless));
 
   // create instance
   vk::InstanceCreateInfo info;
@@ -230,14 +265,17 @@ void Instance::pickPhysicalDevice() {
     // check whether the required queue families are supported
     int graphicsFamily{chooseQueueFamily(physicalDevice, vk::QueueFlagBits::eGraphics)};
     int computeFamily{chooseQueueFamily(physicalDevice, vk::QueueFlagBits::eCompute)};
-    int presentFamily{choosePresentQueueFamily(physicalDevice, *mVkInstance)};
+    int presentFamily{mHeadless ? graphicsFamily
+                                : choosePresentQueueFamily(physicalDevice, *mVkInstance)};
+    int transferFamily{chooseTransferQueueFamily(physicalDevice)};
 
     // check whether all required queue types are supported
     if (graphicsFamily < 0 || presentFamily < 0 || computeFamily < 0) { continue; }
 
     // check whether all required extensions are supported
     auto                  availableExtensions{physicalDevice.enumerateDeviceExtensionProperties()};
-    std::set<std::string> requiredExtensions{DEVICE_EXTENSIONS.begin(), DEVICE_EXTENSIONS.end()};
+    auto                  deviceExtensions{getRequiredDeviceExtensions(mHeadless)};
+    std::set<std::string> requiredExtensions{deviceExtensions.begin(), deviceExtensions.end()};
 
     for (auto const& extension : availableExtensions) {
       requiredExtensions.erase(extension.extensionName);
@@ -250,6 +288,7 @@ void Instance::pickPhysicalDevice() {
     mGraphicsFamily = graphicsFamily;
     mComputeFamily  = computeFamily;
     mPresentFamily  = presentFamily;
+    mTransferFamily = transferFamily >= 0 ? transferFamily : graphicsFamily;
 
     if (mDebugMode) { mPhysicalDevice->printInfo(); }
 
@@ -268,7 +307,8 @@ VkDevicePtr Instance::createVkDevice() const {
   const float              queuePriority{1.0f};
   const std::set<uint32_t> uniqueQueueFamilies{(uint32_t)mGraphicsFamily,
                                                (uint32_t)mComputeFamily,
-                                               (uint32_t)mPresentFamily};
+                                               (uint32_t)mPresentFamily,
+                                               (uint32_t)mTransferFamily};
 
   for (uint32_t queueFamily : uniqueQueueFamilies) {
     vk::DeviceQueueCreateInfo queueCreateInfo;
@@ -281,12 +321,14 @@ VkDevicePtr Instance::createVkDevice() const {
   vk::PhysicalDeviceFeatures deviceFeatures;
   deviceFeatures.samplerAnisotropy = true;
 
+  auto deviceExtensions{getRequiredDeviceExtensions(mHeadless)};
+
   vk::DeviceCreateInfo createInfo;
   createInfo.pQueueCreateInfos       = queueCreateInfos.data();
   createInfo.queueCreateInfoCount    = (uint32_t)queueCreateInfos.size();
   createInfo.pEnabledFeatures        = &deviceFeatures;
-  createInfo.enabledExtensionCount   = static_cast<uint32_t>(DEVICE_EXTENSIONS.size());
-  createInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
+  createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size());
+  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
   return mPhysicalDevice->createVkDevice(createInfo);
 }
@@ -294,6 +336,10 @@ VkDevicePtr Instance::createVkDevice() const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 VkSurfaceKHRPtr Instance::createVkSurface(GLFWwindow* window) const {
+  if (mHeadless) {
+    throw std::runtime_error{"Failed to create window surface: The instance is headless!"};
+  }
+
   VkSurfaceKHR tmp;
   if (glfwCreateWindowSurface(*mVkInstance, window, nullptr, &tmp) != VK_SUCCESS) {
     throw std::runtime_error{"Failed to create window surface!"};
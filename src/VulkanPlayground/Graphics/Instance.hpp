@@ -27,16 +27,23 @@ class Instance {
 
  public:
   // -------------------------------------------------------------------------------- public methods
-  Instance(std::string const& appName, bool debugMode = true);
+  // A headless instance does not initialize GLFW and does not require presentation support. It
+  // can be used with offscreen surfaces only, for example on machines without a display.
+  Instance(std::string const& appName, bool debugMode = true, bool headless = false);
 
   VkDevicePtr     createVkDevice() const;
   VkSurfaceKHRPtr createVkSurface(GLFWwindow* window) const;
 
+  bool                     isHeadless() const { return mHeadless; }
   PhysicalDevicePtr const& getPhysicalDevice() const { return mPhysicalDevice; }
   int                      getGraphicsFamily() const { return mGraphicsFamily; }
   int                      getComputeFamily() const { return mComputeFamily; }
   int                      getPresentFamily() const { return mPresentFamily; }
 
+  // This is a transfer-only family if the device has one, else it is the graphics family.
+  int  getTransferFamily() const { return mTransferFamily; }
+  bool hasDedicatedTransferFamily() const { return mTransferFamily != mGraphicsFamily; }
+
  private:
   // ------------------------------------------------------------------------------- private methods
   void createInstance(std::string const& engineName, std::string const& appName);
@@ -48,9 +55,10 @@ class Instance {
   VkDebugReportCallbackEXTPtr mVkDebugCallback;
   PhysicalDevicePtr           mPhysicalDevice;
 
-  int mGraphicsFamily{-1}, mComputeFamily{-1}, mPresentFamily{-1};
+  int mGraphicsFamily{-1}, mComputeFamily{-1}, mPresentFamily{-1}, mTransferFamily{-1};
 
   bool mDebugMode{false};
+  bool mHeadless{false};
 };
 }
 }
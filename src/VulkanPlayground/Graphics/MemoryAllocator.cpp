@@ -0,0 +1,403 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "MemoryAllocator.hpp"
+
+#include "../Utils/Logger.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+namespace Illusion {
+namespace Graphics {
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MemoryAllocator::MemoryAllocator(
+  std::shared_ptr<Backend> const&           backend,
+  vk::PhysicalDeviceMemoryProperties const& memoryProperties,
+  vk::DeviceSize                            bufferImageGranularity,
+  vk::DeviceSize                            nonCoherentAtomSize,
+  vk::DeviceSize                            pageSize)
+  : mBackend(backend)
+  , mMemoryProperties(memoryProperties)
+  , mBufferImageGranularity(std::max<vk::DeviceSize>(1, bufferImageGranularity))
+  , mNonCoherentAtomSize(std::max<vk::DeviceSize>(1, nonCoherentAtomSize))
+  , mPageSizes(memoryProperties.memoryTypeCount)
+  , mPages(memoryProperties.memoryTypeCount) {
+
+  // small heaps (e.g. the host visible device local heap on some GPUs) should not be exhausted by
+  // only a few pages
+  for (uint32_t i{0}; i < memoryProperties.memoryTypeCount; ++i) {
+    auto heapSize{memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size};
+    mPageSizes[i] = std::min(pageSize, std::max<vk::DeviceSize>(1, heapSize / 8));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MemoryAllocator::~MemoryAllocator() {
+  for (auto& pages : mPages) {
+    for (auto& page : pages) {
+      mBackend->free(page.mMemory);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MemoryAllocationPtr MemoryAllocator::allocate(
+  vk::MemoryRequirements const& requirements,
+  vk::MemoryPropertyFlags       properties,
+  ResourceType                  type) {
+
+  uint32_t       memoryType{findMemoryType(requirements.memoryTypeBits, properties)};
+  vk::DeviceSize alignment{std::max<vk::DeviceSize>(1, requirements.alignment)};
+  vk::DeviceSize size{requirements.size};
+
+  // flush ranges of non-coherent memory have to be multiples of nonCoherentAtomSize
+  auto flags{mMemoryProperties.memoryTypes[memoryType].propertyFlags};
+  if (
+    (flags & vk::MemoryPropertyFlagBits::eHostVisible) &&
+    !(flags & vk::MemoryPropertyFlagBits::eHostCoherent)) {
+    alignment = alignUp(alignment, mNonCoherentAtomSize);
+    size      = alignUp(size, mNonCoherentAtomSize);
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Page*          page{nullptr};
+  vk::DeviceSize offset{0};
+
+  if (size > mPageSizes[memoryType] / 2) {
+    page = createPage(memoryType, size, true);
+  } else {
+    for (auto& candidate : mPages[memoryType]) {
+      if (!candidate.mIsDedicated && findRange(candidate, size, alignment, type, offset)) {
+        page = &candidate;
+        break;
+      }
+    }
+
+    if (!page) {
+      page = createPage(memoryType, mPageSizes[memoryType], false);
+
+      if (!findRange(*page, size, alignment, type, offset)) {
+        releasePage(page);
+        throw std::runtime_error{"Failed to allocate memory: Alignment exceeds page size!"};
+      }
+    }
+  }
+
+  // split the free range which contains the new allocation
+  auto range = std::prev(page->mFreeRanges.upper_bound(offset));
+
+  vk::DeviceSize rangeStart{range->first};
+  vk::DeviceSize rangeEnd{range->first + range->second};
+
+  page->mFreeRanges.erase(range);
+
+  if (offset > rangeStart) { page->mFreeRanges[rangeStart] = offset - rangeStart; }
+  if (offset + size < rangeEnd) { page->mFreeRanges[offset + size] = rangeEnd - offset - size; }
+
+  page->mUsedRanges[offset] = {size, type};
+
+  auto allocation         = new MemoryAllocation;
+  allocation->mMemory     = page->mMemory;
+  allocation->mOffset     = offset;
+  allocation->mSize       = size;
+  allocation->mMemoryType = memoryType;
+  allocation->mPage       = page;
+
+  // the allocation keeps the allocator alive
+  auto allocator{shared_from_this()};
+  return MemoryAllocationPtr(allocation, [allocator](MemoryAllocation* obj) {
+    allocator->free(*obj);
+    delete obj;
+  });
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void* MemoryAllocator::map(MemoryAllocation const& allocation) {
+  auto flags{mMemoryProperties.memoryTypes[allocation.mMemoryType].propertyFlags};
+  if (!(flags & vk::MemoryPropertyFlagBits::eHostVisible)) {
+    throw std::runtime_error{"Failed to map memory: Memory type is not host visible!"};
+  }
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Page* page{allocation.mPage};
+  if (!page->mMappedData) { page->mMappedData = mBackend->map(page->mMemory, page->mSize); }
+
+  return static_cast<uint8_t*>(page->mMappedData) + allocation.mOffset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryAllocator::flush(
+  MemoryAllocation const& allocation, vk::DeviceSize offset, vk::DeviceSize size) {
+
+  if (isHostCoherent(allocation) || offset >= allocation.mSize) { return; }
+
+  if (size == VK_WHOLE_SIZE || offset + size > allocation.mSize) {
+    size = allocation.mSize - offset;
+  }
+
+  // the allocation itself starts and ends on atom boundaries
+  vk::DeviceSize start{allocation.mOffset + offset / mNonCoherentAtomSize * mNonCoherentAtomSize};
+  vk::DeviceSize end{allocation.mOffset + alignUp(offset + size, mNonCoherentAtomSize)};
+
+  mBackend->flush(allocation.mMemory, start, end - start);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MemoryAllocator::isHostCoherent(MemoryAllocation const& allocation) const {
+  auto flags{mMemoryProperties.memoryTypes[allocation.mMemoryType].propertyFlags};
+  return static_cast<bool>(flags & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MemoryAllocator::Statistics MemoryAllocator::getStatistics() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Statistics     result;
+  vk::DeviceSize freeBytes{0}, largestFreeBytes{0};
+
+  for (auto const& pages : mPages) {
+    for (auto const& page : pages) {
+      PageInfo info;
+      info.mMemoryType      = page.mMemoryType;
+      info.mSize            = page.mSize;
+      info.mAllocationCount = static_cast<uint32_t>(page.mUsedRanges.size());
+      info.mFreeRangeCount  = static_cast<uint32_t>(page.mFreeRanges.size());
+      info.mIsDedicated     = page.mIsDedicated;
+
+      for (auto const& range : page.mUsedRanges) {
+        info.mUsedBytes += range.second.mSize;
+      }
+
+      for (auto const& range : page.mFreeRanges) {
+        info.mLargestFreeRange = std::max(info.mLargestFreeRange, range.second);
+        freeBytes += range.second;
+      }
+
+      largestFreeBytes += info.mLargestFreeRange;
+
+      result.mPageCount += 1;
+      result.mAllocationCount += info.mAllocationCount;
+      result.mReservedBytes += info.mSize;
+      result.mUsedBytes += info.mUsedBytes;
+      result.mPages.push_back(info);
+    }
+  }
+
+  if (freeBytes > 0) {
+    result.mFragmentation = 1.f - static_cast<float>(largestFreeBytes) / freeBytes;
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryAllocator::printInfo() const {
+  auto statistics{getStatistics()};
+
+  auto toMB = [](vk::DeviceSize bytes) {
+    std::stringstream sstr;
+    sstr << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0) << " MB";
+    return sstr.str();
+  };
+
+  ILLUSION_DEBUG << Logger::PRINT_BOLD << "Memory Allocator Information " << Logger::PRINT_RESET
+                 << std::endl;
+  ILLUSION_DEBUG << "Pages: " << statistics.mPageCount
+                 << ", Allocations: " << statistics.mAllocationCount
+                 << ", Used: " << toMB(statistics.mUsedBytes) << " of "
+                 << toMB(statistics.mReservedBytes)
+                 << ", Fragmentation: " << statistics.mFragmentation << std::endl;
+
+  for (auto const& page : statistics.mPages) {
+    ILLUSION_DEBUG << "  Memory type " << page.mMemoryType
+                   << (page.mIsDedicated ? " (dedicated)" : "") << ": " << toMB(page.mUsedBytes)
+                   << " of " << toMB(page.mSize) << " in "
+                   << page.mAllocationCount << " allocations, " << page.mFreeRangeCount
+                   << " free ranges, largest " << toMB(page.mLargestFreeRange) << std::endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t
+MemoryAllocator::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const {
+  for (uint32_t i{0}; i < mMemoryProperties.memoryTypeCount; i++) {
+    if (
+      (typeFilter & (1 << i)) &&
+      (mMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+
+  throw std::runtime_error{"Failed to find suitable memory type."};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MemoryAllocator::Page*
+MemoryAllocator::createPage(uint32_t memoryType, vk::DeviceSize size, bool dedicated) {
+  Page page;
+  page.mMemory      = mBackend->allocate(memoryType, size);
+  page.mSize        = size;
+  page.mMemoryType  = memoryType;
+  page.mIsDedicated = dedicated;
+  page.mFreeRanges[0] = size;
+
+  mPages[memoryType].push_back(page);
+
+  return &mPages[memoryType].back();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryAllocator::releasePage(Page* page) {
+  auto& pages = mPages[page->mMemoryType];
+
+  for (auto it = pages.begin(); it != pages.end(); ++it) {
+    if (&(*it) == page) {
+      mBackend->free(page->mMemory);
+      pages.erase(it);
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MemoryAllocator::findRange(
+  Page const&     page,
+  vk::DeviceSize  size,
+  vk::DeviceSize  alignment,
+  ResourceType    type,
+  vk::DeviceSize& offset) const {
+
+  bool           found{false};
+  vk::DeviceSize bestWaste{0};
+
+  // returns true if a used range of the other resource type overlaps [start, end); several small
+  // allocations may share one granularity page, so this is not limited to the direct neighbours
+  auto hasConflict = [&](vk::DeviceSize start, vk::DeviceSize end) {
+    auto used = page.mUsedRanges.lower_bound(start);
+    if (used != page.mUsedRanges.begin()) { --used; }
+
+    for (; used != page.mUsedRanges.end() && used->first < end; ++used) {
+      if (used->second.mType != type && used->first + used->second.mSize > start) { return true; }
+    }
+
+    return false;
+  };
+
+  for (auto const& range : page.mFreeRanges) {
+    vk::DeviceSize rangeStart{range.first};
+    vk::DeviceSize rangeEnd{range.first + range.second};
+    vk::DeviceSize candidate{alignUp(rangeStart, alignment)};
+
+    // the start of the first granularity page of the candidate
+    vk::DeviceSize firstPage{candidate / mBufferImageGranularity * mBufferImageGranularity};
+    if (hasConflict(firstPage, candidate)) {
+      candidate = alignUp(candidate, mBufferImageGranularity);
+    }
+
+    if (candidate + size > rangeEnd) { continue; }
+
+    // the end of the last granularity page of the candidate
+    vk::DeviceSize lastPage{alignUp(candidate + size, mBufferImageGranularity)};
+    if (hasConflict(candidate + size, lastPage)) { continue; }
+
+    // best fit: prefer the range which leaves the least space unused
+    vk::DeviceSize waste{rangeEnd - candidate - size};
+    if (!found || waste < bestWaste) {
+      found     = true;
+      bestWaste = waste;
+      offset    = candidate;
+    }
+  }
+
+  return found;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MemoryAllocator::free(MemoryAllocation const& allocation) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Page* page{allocation.mPage};
+  page->mUsedRanges.erase(allocation.mOffset);
+
+  // merge with adjacent free ranges
+  vk::DeviceSize start{allocation.mOffset};
+  vk::DeviceSize size{allocation.mSize};
+
+  auto next = page->mFreeRanges.lower_bound(start);
+
+  if (next != page->mFreeRanges.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == start) {
+      start = prev->first;
+      size += prev->second;
+      page->mFreeRanges.erase(prev);
+    }
+  }
+
+  if (next != page->mFreeRanges.end() && start + size == next->first) {
+    size += next->second;
+    page->mFreeRanges.erase(next);
+  }
+
+  page->mFreeRanges[start] = size;
+
+  if (!page->mUsedRanges.empty()) { return; }
+
+  // dedicated pages are released right away, for shared pages we keep one empty page per memory
+  // type to prevent allocation ping-pong
+  if (page->mIsDedicated) {
+    releasePage(page);
+    return;
+  }
+
+  for (auto const& other : mPages[page->mMemoryType]) {
+    if (&other != page && !other.mIsDedicated && other.mUsedRanges.empty()) {
+      releasePage(page);
+      return;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_MEMORY_ALLOCATOR_HPP
+#define ILLUSION_GRAPHICS_MEMORY_ALLOCATOR_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../fwd.hpp"
+
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// The MemoryAllocator reserves large pages of device memory per memory type and hands out        //
+// sub-ranges of them. Placement is best-fit on a sorted free-list; neighbouring free ranges are  //
+// merged again when an allocation is released. Linear and optimal resources are kept apart by    //
+// bufferImageGranularity. Resources which are larger than half a page get a dedicated page.      //
+// The actual vkAllocateMemory calls go through a Backend, so the placement logic can be driven   //
+// by a fake backend without any Vulkan device.                                                   //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class MemoryAllocator : public std::enable_shared_from_this<MemoryAllocator> {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  // Buffers and linearly tiled images are eLinear, optimally tiled images are eOptimal.
+  enum class ResourceType { eLinear, eOptimal };
+
+  // This is the only place where device memory is actually allocated.
+  class Backend {
+   public:
+    virtual ~Backend() {}
+
+    virtual vk::DeviceMemory allocate(uint32_t memoryType, vk::DeviceSize size) = 0;
+    virtual void free(vk::DeviceMemory const& memory) = 0;
+    virtual void* map(vk::DeviceMemory const& memory, vk::DeviceSize size) = 0;
+    virtual void flush(
+      vk::DeviceMemory const& memory, vk::DeviceSize offset, vk::DeviceSize size) = 0;
+  };
+
+  struct PageInfo {
+    uint32_t       mMemoryType{0};
+    vk::DeviceSize mSize{0};
+    vk::DeviceSize mUsedBytes{0};
+    vk::DeviceSize mLargestFreeRange{0};
+    uint32_t       mAllocationCount{0};
+    uint32_t       mFreeRangeCount{0};
+    bool           mIsDedicated{false};
+  };
+
+  struct Statistics {
+    uint32_t       mPageCount{0};
+    uint32_t       mAllocationCount{0};
+    vk::DeviceSize mReservedBytes{0};
+    vk::DeviceSize mUsedBytes{0};
+
+    // 0 means that the free space of each page is one contiguous range, values close to 1 mean
+    // that the free space is scattered over many small ranges
+    float mFragmentation{0.f};
+
+    std::vector<PageInfo> mPages;
+  };
+
+  // internal bookkeeping of one vk::DeviceMemory object
+  struct Page;
+
+  // -------------------------------------------------------------------------------- public methods
+  MemoryAllocator(
+    std::shared_ptr<Backend> const&           backend,
+    vk::PhysicalDeviceMemoryProperties const& memoryProperties,
+    vk::DeviceSize                            bufferImageGranularity,
+    vk::DeviceSize                            nonCoherentAtomSize,
+    vk::DeviceSize                            pageSize = 64 * 1024 * 1024);
+  virtual ~MemoryAllocator();
+
+  // The returned allocation gives its range back to the allocator once it gets destroyed.
+  MemoryAllocationPtr allocate(
+    vk::MemoryRequirements const& requirements,
+    vk::MemoryPropertyFlags       properties,
+    ResourceType                  type);
+
+  // Pages of host visible memory are mapped once when this is called for the first time and stay
+  // mapped until the page is released. Hence there is no unmap().
+  void* map(MemoryAllocation const& allocation);
+
+  // Makes host writes to the given range (relative to the allocation) visible to the device. This
+  // does nothing for host coherent memory. Allocations in non-coherent memory are aligned to
+  // nonCoherentAtomSize, so flushing never touches neighbouring allocations.
+  void flush(
+    MemoryAllocation const& allocation,
+    vk::DeviceSize          offset = 0,
+    vk::DeviceSize          size   = VK_WHOLE_SIZE);
+
+  bool isHostCoherent(MemoryAllocation const& allocation) const;
+
+  Statistics getStatistics() const;
+  void       printInfo() const;
+
+ private:
+  // ------------------------------------------------------------------------------- private methods
+  uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
+
+  Page* createPage(uint32_t memoryType, vk::DeviceSize size, bool dedicated);
+  void  releasePage(Page* page);
+
+  bool findRange(
+    Page const&     page,
+    vk::DeviceSize  size,
+    vk::DeviceSize  alignment,
+    ResourceType    type,
+    vk::DeviceSize& offset) const;
+
+  void free(MemoryAllocation const& allocation);
+
+  // ------------------------------------------------------------------------------- private members
+  std::shared_ptr<Backend>           mBackend;
+  vk::PhysicalDeviceMemoryProperties mMemoryProperties;
+  vk::DeviceSize                     mBufferImageGranularity;
+  vk::DeviceSize                     mNonCoherentAtomSize;
+  std::vector<vk::DeviceSize>        mPageSizes;
+  std::vector<std::list<Page>>       mPages;
+  mutable std::mutex                 mMutex;
+};
+
+// -------------------------------------------------------------------------------------------------
+struct MemoryAllocator::Page {
+  struct UsedRange {
+    vk::DeviceSize mSize;
+    ResourceType   mType;
+  };
+
+  vk::DeviceMemory mMemory;
+  vk::DeviceSize   mSize{0};
+  uint32_t         mMemoryType{0};
+  bool             mIsDedicated{false};
+  void*            mMappedData{nullptr};
+
+  // both are sorted by offset; free ranges are always maximal, that is two free ranges are never
+  // adjacent
+  std::map<vk::DeviceSize, vk::DeviceSize> mFreeRanges;
+  std::map<vk::DeviceSize, UsedRange>      mUsedRanges;
+};
+
+// -------------------------------------------------------------------------------------------------
+struct MemoryAllocation {
+  vk::DeviceMemory mMemory;
+  vk::DeviceSize   mOffset{0};
+  vk::DeviceSize   mSize{0};
+  uint32_t         mMemoryType{0};
+
+  // owned by the MemoryAllocator
+  MemoryAllocator::Page* mPage{nullptr};
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_MEMORY_ALLOCATOR_HPP
@@ -113,6 +113,16 @@ PhysicalDevice::findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags prop
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool PhysicalDevice::supportsLinearBlit(vk::Format format) const {
+  vk::FormatFeatureFlags required{vk::FormatFeatureFlagBits::eBlitSrc |
+                                  vk::FormatFeatureFlagBits::eBlitDst |
+                                  vk::FormatFeatureFlagBits::eSampledImageFilterLinear};
+
+  return (getFormatProperties(format).optimalTilingFeatures & required) == required;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void PhysicalDevice::printInfo() {
   // basic information
   vk::PhysicalDeviceProperties properties{getProperties()};
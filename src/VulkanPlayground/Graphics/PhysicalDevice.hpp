@@ -29,6 +29,10 @@ class PhysicalDevice : public vk::PhysicalDevice {
 
   uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const;
 
+  // Returns true if optimally tiled images of the given format can be used as source and
+  // destination of vkCmdBlitImage with linear filtering, as required for mipmap generation.
+  bool supportsLinearBlit(vk::Format format) const;
+
   void printInfo();
 };
 }
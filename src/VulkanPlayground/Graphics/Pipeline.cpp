@@ -13,8 +13,10 @@
 
 #include "../Utils/File.hpp"
 #include "../Utils/Logger.hpp"
+#include "../Utils/Profiler.hpp"
 #include "Device.hpp"
 #include "ShaderReflection.hpp"
+#include "ShaderReflectionCache.hpp"
 #include "Surface.hpp"
 #include "Window.hpp"
 
@@ -33,14 +35,17 @@ Pipeline::Pipeline(
   : mDevice(device)
   , mVkRenderPass(renderPass) {
 
+  ILLUSION_PROFILE_ZONE("Pipeline::Pipeline");
+
   // create shader reflection ----------------------------------------------------------------------
-  std::vector<ShaderReflectionPtr>   reflections;
-  std::vector<std::vector<uint32_t>> shaderCodes;
+  std::vector<ShaderReflectionPtr> reflections;
+  std::vector<MappedFilePtr>       shaderCodes;
 
   for (auto const& shaderFile : shaderFiles) {
     try {
-      shaderCodes.push_back(File<uint32_t>(shaderFile).getContent());
-      reflections.push_back(std::make_shared<ShaderReflection>(shaderCodes.back()));
+      shaderCodes.push_back(File<uint32_t>(shaderFile).map());
+      reflections.push_back(
+        mDevice->getShaderReflectionCache()->get(shaderCodes.back()->getSpan<uint32_t>()));
     } catch (std::runtime_error const& e) {
       throw std::runtime_error{"Failed to get reflection information for " + shaderFile + ": " +
                                e.what()};
@@ -190,8 +195,9 @@ Pipeline::Pipeline(
 
   for (size_t i{0}; i < reflections.size(); ++i) {
     vk::ShaderModuleCreateInfo moduleInfo;
-    moduleInfo.codeSize = shaderCodes[i].size() * 4;
-    moduleInfo.pCode    = shaderCodes[i].data();
+    auto code           = shaderCodes[i]->getSpan<uint32_t>();
+    moduleInfo.codeSize = code.sizeInBytes();
+    moduleInfo.pCode    = code.data();
 
     auto module = mDevice->createVkShaderModule(moduleInfo);
 
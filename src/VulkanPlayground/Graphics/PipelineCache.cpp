@@ -0,0 +1,189 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "PipelineCache.hpp"
+
+#include "../Utils/Logger.hpp"
+#include "PhysicalDevice.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// "ILPC" in little endian
+const uint32_t FILE_MAGIC{0x43504c49};
+const uint32_t FILE_VERSION{1};
+
+// this is how every vk::PipelineCache data blob starts, see the Vulkan specification of
+// vkGetPipelineCacheData
+struct VulkanHeader {
+  uint32_t mLength;
+  uint32_t mVersion;
+  uint32_t mVendorID;
+  uint32_t mDeviceID;
+  uint8_t  mPipelineCacheUUID[VK_UUID_SIZE];
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PipelineCache::PipelineCache(
+  VkDevicePtr const&       device,
+  PhysicalDevicePtr const& physicalDevice,
+  std::string const&       fileName)
+  : mDevice(device)
+  , mPhysicalDevice(physicalDevice)
+  , mFile(fileName, FILE_MAGIC, FILE_VERSION, "pipeline cache") {
+
+  auto data = load();
+
+  vk::PipelineCacheCreateInfo info;
+  info.initialDataSize = data.size();
+  info.pInitialData    = data.data();
+
+  ILLUSION_DEBUG << "Creating pipeline cache." << std::endl;
+
+  try {
+    mVkPipelineCache = mDevice->createPipelineCache(info);
+  } catch (std::runtime_error const& e) {
+
+    // the driver may reject data which passed our checks; start with an empty cache in this case
+    ILLUSION_WARNING << "Discarding pipeline cache \"" << mFile.getFileName()
+                     << "\": " << e.what() << std::endl;
+    mVkPipelineCache = mDevice->createPipelineCache(vk::PipelineCacheCreateInfo());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PipelineCache::~PipelineCache() {
+  save();
+
+  ILLUSION_DEBUG << "Deleting pipeline cache." << std::endl;
+  mDevice->destroyPipelineCache(mVkPipelineCache);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vk::Pipeline PipelineCache::createGraphicsPipeline(vk::GraphicsPipelineCreateInfo const& info) {
+  // if pipelines are compiled on several threads at once, the data may grow because another thread
+  // adds its pipeline in the meantime
+  size_t sizeBefore{getDataSize()};
+
+  auto start    = std::chrono::steady_clock::now();
+  auto pipeline = mDevice->createGraphicsPipeline(mVkPipelineCache, info);
+  auto duration =
+    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start);
+
+  bool grown{getDataSize() > sizeBefore};
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (grown) {
+      ++mStatistics.mGrown;
+      mStatistics.mGrownTime += duration.count();
+    } else {
+      ++mStatistics.mNotGrown;
+      mStatistics.mNotGrownTime += duration.count();
+    }
+  }
+
+  ILLUSION_DEBUG << "Pipeline cache " << (grown ? "grew" : "did not grow") << " ("
+                 << duration.count() << " ms)." << std::endl;
+
+  return pipeline;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool PipelineCache::save() const {
+  if (mFile.getFileName().empty()) { return false; }
+
+  return mFile.save(mDevice->getPipelineCacheData(mVkPipelineCache));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PipelineCache::Statistics PipelineCache::getStatistics() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mStatistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PipelineCache::printStatistics() const {
+  auto statistics = getStatistics();
+
+  ILLUSION_MESSAGE
+    << "Pipeline cache: grew on " << statistics.mGrown << " creations ("
+    << (statistics.mGrown > 0 ? statistics.mGrownTime / statistics.mGrown : 0.0)
+    << " ms avg), did not grow on " << statistics.mNotGrown << " creations ("
+    << (statistics.mNotGrown > 0 ? statistics.mNotGrownTime / statistics.mNotGrown : 0.0)
+    << " ms avg)." << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint8_t> PipelineCache::load() const {
+  auto data = mFile.load();
+  if (data.empty()) { return data; }
+
+  VulkanHeader vkHeader;
+  if (data.size() < sizeof(VulkanHeader)) {
+    ILLUSION_WARNING << "Discarding pipeline cache \"" << mFile.getFileName()
+                     << "\": Data is truncated." << std::endl;
+    return {};
+  }
+
+  std::memcpy(&vkHeader, data.data(), sizeof(VulkanHeader));
+
+  auto properties = mPhysicalDevice->getProperties();
+
+  if (
+    vkHeader.mLength < sizeof(VulkanHeader) ||
+    vkHeader.mVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+    vkHeader.mVendorID != properties.vendorID || vkHeader.mDeviceID != properties.deviceID ||
+    std::memcmp(vkHeader.mPipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+    ILLUSION_WARNING << "Discarding pipeline cache \"" << mFile.getFileName()
+                     << "\": It was created by another device or driver version." << std::endl;
+    return {};
+  }
+
+  ILLUSION_DEBUG << "Loaded pipeline cache \"" << mFile.getFileName() << "\" (" << data.size()
+                 << " bytes)." << std::endl;
+
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t PipelineCache::getDataSize() const {
+  size_t size{0};
+  vkGetPipelineCacheData(
+    static_cast<VkDevice>(*mDevice),
+    static_cast<VkPipelineCache>(mVkPipelineCache),
+    &size,
+    nullptr);
+  return size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_PIPELINE_CACHE_HPP
+#define ILLUSION_GRAPHICS_PIPELINE_CACHE_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../Utils/CacheFile.hpp"
+#include "../fwd.hpp"
+
+#include <mutex>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A vk::PipelineCache which is loaded from a file on construction and written back on            //
+// destruction or when save() is called. The file is read and written by a CacheFile, which       //
+// discards truncated or corrupt files. The Vulkan header of the data is compared against the     //
+// vendor ID, device ID and pipeline cache UUID of the physical device; a cache from another      //
+// device or driver version is discarded as well.                                                 //
+// The statistics count how often a pipeline creation grew the cache data and how often it did    //
+// not. This is a hint only: drivers are not required to add data on a miss, and pipelines which  //
+// are created concurrently may be attributed to each other.                                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class PipelineCache {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  struct Statistics {
+    uint32_t mGrown{0};
+    uint32_t mNotGrown{0};
+
+    // accumulated creation times in milliseconds
+    double mGrownTime{0.0};
+    double mNotGrownTime{0.0};
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  // If fileName is empty, the cache is neither loaded nor saved.
+  PipelineCache(
+    VkDevicePtr const&       device,
+    PhysicalDevicePtr const& physicalDevice,
+    std::string const&       fileName);
+  virtual ~PipelineCache();
+
+  // Creates the pipeline using the cache and updates the statistics. This can be called from
+  // multiple threads at once.
+  vk::Pipeline createGraphicsPipeline(vk::GraphicsPipelineCreateInfo const& info);
+
+  // Writes the cache to disk. The file is replaced atomically, so a crash while saving does not
+  // leave a corrupt cache behind.
+  bool save() const;
+
+  vk::PipelineCache const& getVkPipelineCache() const { return mVkPipelineCache; }
+  Statistics               getStatistics() const;
+  void                     printStatistics() const;
+
+ private:
+  // ------------------------------------------------------------------------------- private methods
+  // returns an empty vector if the file does not exist or cannot be used
+  std::vector<uint8_t> load() const;
+  size_t               getDataSize() const;
+
+  // ------------------------------------------------------------------------------- private members
+  VkDevicePtr       mDevice;
+  PhysicalDevicePtr mPhysicalDevice;
+  CacheFile         mFile;
+  vk::PipelineCache mVkPipelineCache;
+
+  Statistics         mStatistics;
+  mutable std::mutex mMutex;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_PIPELINE_CACHE_HPP
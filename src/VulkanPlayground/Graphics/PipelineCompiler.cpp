@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "PipelineCompiler.hpp"
+
+#include "../Utils/Logger.hpp"
+#include "Pipeline.hpp"
+
+#include <chrono>
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncPipeline::AsyncPipeline(std::shared_future<PipelinePtr> const& future)
+  : mFuture(future) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool AsyncPipeline::isReady() const {
+  return mFuture.valid() &&
+         mFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PipelinePtr const& AsyncPipeline::wait() const {
+  if (!mFuture.valid()) {
+    throw std::runtime_error{"Failed to wait for pipeline: AsyncPipeline is empty!"};
+  }
+
+  return mFuture.get();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PipelinePtr const& AsyncPipeline::get(PipelinePtr const& fallback) const {
+  if (isReady()) { return mFuture.get(); }
+  return fallback;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PipelineCompiler::PipelineCompiler(DevicePtr const& device, uint32_t threadCount)
+  : mDevice(device)
+  , mJobSystem(threadCount) {
+
+  ILLUSION_DEBUG << "Creating pipeline compiler with " << mJobSystem.getThreadCount()
+                 << " threads." << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PipelineCompiler::~PipelineCompiler() {
+  ILLUSION_DEBUG << "Deleting pipeline compiler." << std::endl;
+  mJobSystem.wait();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncPipeline PipelineCompiler::compile(
+  VkRenderPassPtr const&          renderPass,
+  std::vector<std::string> const& shaderFiles,
+  uint32_t                        materialCount) {
+
+  auto device{mDevice};
+  auto future{mJobSystem.enqueue([device, renderPass, shaderFiles, materialCount]() {
+    return std::make_shared<Pipeline>(device, renderPass, shaderFiles, materialCount);
+  })};
+
+  return AsyncPipeline(future.share());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void PipelineCompiler::wait() { mJobSystem.wait(); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_PIPELINE_COMPILER_HPP
+#define ILLUSION_GRAPHICS_PIPELINE_COMPILER_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../Utils/JobSystem.hpp"
+#include "../fwd.hpp"
+
+#include <future>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// The PipelineCompiler constructs Pipelines on a pool of worker threads. compile() returns an    //
+// AsyncPipeline right away; it can be polled, waited on or asked for the pipeline with a         //
+// fallback which is used as long as the compilation has not finished. Several pipelines are      //
+// compiled in parallel - the Vulkan pipeline cache is internally synchronized, so there is no    //
+// lock around the driver's compilation. compile() itself may be called from any thread.          //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class AsyncPipeline {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  // A default constructed AsyncPipeline is never ready.
+  AsyncPipeline() = default;
+  explicit AsyncPipeline(std::shared_future<PipelinePtr> const& future);
+
+  // Returns true once the pipeline has been compiled or its compilation failed.
+  bool isReady() const;
+
+  // Blocks until the pipeline has been compiled. Errors of the compilation are rethrown here.
+  PipelinePtr const& wait() const;
+
+  // Returns the pipeline if it is ready, else the given fallback. If the compilation failed, the
+  // error is rethrown.
+  PipelinePtr const& get(PipelinePtr const& fallback) const;
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  std::shared_future<PipelinePtr> mFuture;
+};
+
+// -------------------------------------------------------------------------------------------------
+class PipelineCompiler {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  // By default, one thread is left for the thread which records the frames.
+  explicit PipelineCompiler(
+    DevicePtr const& device,
+    uint32_t threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1);
+
+  // Waits for all pending compilations.
+  virtual ~PipelineCompiler();
+
+  // The arguments are the same as for the constructor of the Pipeline.
+  AsyncPipeline compile(
+    VkRenderPassPtr const&          renderPass,
+    std::vector<std::string> const& shaderFiles,
+    uint32_t                        materialCount);
+
+  // Blocks until all pipelines requested so far have been compiled.
+  void wait();
+
+  uint32_t getThreadCount() const { return mJobSystem.getThreadCount(); }
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  DevicePtr mDevice;
+  JobSystem mJobSystem;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_PIPELINE_COMPILER_HPP
@@ -0,0 +1,365 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "ResourceStateTracker.hpp"
+
+#include <stdexcept>
+
+namespace Illusion {
+namespace Graphics {
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const vk::AccessFlags WRITE_ACCESS{
+  vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eColorAttachmentWrite |
+  vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eTransferWrite |
+  vk::AccessFlagBits::eHostWrite | vk::AccessFlagBits::eMemoryWrite};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ResourceStateTracker::addImage(
+  vk::Image const&       image,
+  uint32_t               levels,
+  uint32_t               layers,
+  vk::ImageAspectFlags   aspect,
+  vk::ImageLayout        layout,
+  vk::AccessFlags        pendingAccess,
+  vk::PipelineStageFlags pendingStages) {
+
+  State state;
+  state.mLayout      = layout;
+  state.mWriteAccess = pendingAccess;
+  state.mWriteStages = pendingStages;
+
+  removeImage(image);
+
+  auto& imageState   = mImages[static_cast<VkImage>(image)];
+  imageState.mAspect = aspect;
+  imageState.mLevels = levels;
+  imageState.mLayers = layers;
+  imageState.mStates.resize(levels * layers, state);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ResourceStateTracker::removeImage(vk::Image const& image) {
+  auto it = mImages.find(static_cast<VkImage>(image));
+
+  if (it == mImages.end()) { return; }
+
+  if (it->second.mPending) {
+    for (auto& pending : mPendingImages) {
+      if (pending == it->first) {
+        pending = mPendingImages.back();
+        mPendingImages.pop_back();
+        break;
+      }
+    }
+  }
+
+  mImages.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ResourceStateTracker::removeBuffer(vk::Buffer const& buffer) {
+  auto it = mBuffers.find(static_cast<VkBuffer>(buffer));
+
+  if (it == mBuffers.end()) { return; }
+
+  if (it->second.mPending) {
+    for (auto& pending : mPendingBuffers) {
+      if (pending == it->first) {
+        pending = mPendingBuffers.back();
+        mPendingBuffers.pop_back();
+        break;
+      }
+    }
+  }
+
+  mBuffers.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ResourceStateTracker::useImage(
+  vk::Image const&                 image,
+  vk::ImageSubresourceRange const& range,
+  vk::ImageLayout                  layout,
+  vk::AccessFlags                  access,
+  vk::PipelineStageFlags           stages) {
+
+  auto it = mImages.find(static_cast<VkImage>(image));
+
+  if (it == mImages.end()) {
+    throw std::runtime_error{"Failed to use image: Image has not been added to the tracker!"};
+  }
+
+  auto& imageState = it->second;
+
+  uint32_t levelCount{range.levelCount == VK_REMAINING_MIP_LEVELS
+                        ? imageState.mLevels - range.baseMipLevel
+                        : range.levelCount};
+  uint32_t layerCount{range.layerCount == VK_REMAINING_ARRAY_LAYERS
+                        ? imageState.mLayers - range.baseArrayLayer
+                        : range.layerCount};
+
+  if (
+    range.baseMipLevel + levelCount > imageState.mLevels ||
+    range.baseArrayLayer + layerCount > imageState.mLayers) {
+    throw std::runtime_error{"Failed to use image: Subresource range is out of bounds!"};
+  }
+
+  // check for conflicts first, so that nothing is changed if this throws
+  for (uint32_t layer{range.baseArrayLayer}; layer < range.baseArrayLayer + layerCount; ++layer) {
+    for (uint32_t level{range.baseMipLevel}; level < range.baseMipLevel + levelCount; ++level) {
+      auto const& state = imageState.mStates[layer * imageState.mLevels + level];
+
+      if (state.mPending && state.mLayout != layout) {
+        throw std::runtime_error{
+          "Failed to use image: Another layout has been requested before the last flush!"};
+      }
+    }
+  }
+
+  bool pending{false};
+
+  for (uint32_t layer{range.baseArrayLayer}; layer < range.baseArrayLayer + layerCount; ++layer) {
+    for (uint32_t level{range.baseMipLevel}; level < range.baseMipLevel + levelCount; ++level) {
+      auto& state = imageState.mStates[layer * imageState.mLevels + level];
+      pending |= use(state, layout, access, stages);
+    }
+  }
+
+  if (pending && !imageState.mPending) {
+    imageState.mPending = true;
+    mPendingImages.push_back(it->first);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ResourceStateTracker::useBuffer(
+  vk::Buffer const& buffer, vk::AccessFlags access, vk::PipelineStageFlags stages) {
+
+  auto& state = mBuffers[static_cast<VkBuffer>(buffer)];
+
+  // buffers have no layout, hence they never require a transition
+  bool wasPending{state.mPending};
+
+  if (use(state, state.mLayout, access, stages) && !wasPending) {
+    mPendingBuffers.push_back(static_cast<VkBuffer>(buffer));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ResourceStateTracker::flush(vk::CommandBuffer const& commandBuffer) {
+  if (!hasPendingBarriers()) { return; }
+
+  std::vector<vk::ImageMemoryBarrier>  imageBarriers;
+  std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+
+  for (auto const& image : mPendingImages) {
+    auto& imageState = mImages[image];
+
+    // barriers of previous images cannot be merged with the ones of this image
+    size_t first{imageBarriers.size()};
+
+    for (uint32_t layer{0}; layer < imageState.mLayers; ++layer) {
+      uint32_t level{0};
+
+      while (level < imageState.mLevels) {
+        auto& state = imageState.mStates[layer * imageState.mLevels + level];
+
+        if (!state.mPending) {
+          ++level;
+          continue;
+        }
+
+        vk::ImageMemoryBarrier barrier;
+        barrier.oldLayout                       = state.mOldLayout;
+        barrier.newLayout                       = state.mLayout;
+        barrier.srcAccessMask                   = state.mSrcAccess;
+        barrier.dstAccessMask                   = state.mDstAccess;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = vk::Image(image);
+        barrier.subresourceRange.aspectMask     = imageState.mAspect;
+        barrier.subresourceRange.baseMipLevel   = level;
+        barrier.subresourceRange.levelCount     = 0;
+        barrier.subresourceRange.baseArrayLayer = layer;
+        barrier.subresourceRange.layerCount     = 1;
+
+        // extend the barrier to all following levels with the same transition
+        while (level < imageState.mLevels) {
+          auto& next = imageState.mStates[layer * imageState.mLevels + level];
+
+          if (
+            !next.mPending || next.mOldLayout != barrier.oldLayout ||
+            next.mLayout != barrier.newLayout || next.mSrcAccess != barrier.srcAccessMask ||
+            next.mDstAccess != barrier.dstAccessMask) {
+            break;
+          }
+
+          next.mPending = false;
+          ++barrier.subresourceRange.levelCount;
+          ++level;
+        }
+
+        // merge with the same levels of the previous layer if the transition is equal
+        bool merged{false};
+
+        for (size_t i{first}; i < imageBarriers.size() && !merged; ++i) {
+          auto& other = imageBarriers[i];
+
+          if (
+            other.subresourceRange.baseArrayLayer + other.subresourceRange.layerCount == layer &&
+            other.subresourceRange.baseMipLevel == barrier.subresourceRange.baseMipLevel &&
+            other.subresourceRange.levelCount == barrier.subresourceRange.levelCount &&
+            other.oldLayout == barrier.oldLayout && other.newLayout == barrier.newLayout &&
+            other.srcAccessMask == barrier.srcAccessMask &&
+            other.dstAccessMask == barrier.dstAccessMask) {
+            ++other.subresourceRange.layerCount;
+            merged = true;
+          }
+        }
+
+        if (!merged) { imageBarriers.push_back(barrier); }
+      }
+    }
+
+    imageState.mPending = false;
+  }
+
+  for (auto const& buffer : mPendingBuffers) {
+    auto& state = mBuffers[buffer];
+
+    vk::BufferMemoryBarrier barrier;
+    barrier.srcAccessMask       = state.mSrcAccess;
+    barrier.dstAccessMask       = state.mDstAccess;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer              = vk::Buffer(buffer);
+    barrier.offset              = 0;
+    barrier.size                = VK_WHOLE_SIZE;
+    bufferBarriers.push_back(barrier);
+
+    state.mPending = false;
+  }
+
+  commandBuffer.pipelineBarrier(
+    mSrcStages, mDstStages, vk::DependencyFlagBits(), nullptr, bufferBarriers, imageBarriers);
+
+  ++mFlushCount;
+  mBarrierCount += imageBarriers.size() + bufferBarriers.size();
+
+  mPendingImages.clear();
+  mPendingBuffers.clear();
+  mSrcStages = vk::PipelineStageFlags();
+  mDstStages = vk::PipelineStageFlags();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vk::ImageLayout ResourceStateTracker::getLayout(
+  vk::Image const& image, uint32_t level, uint32_t layer) const {
+
+  auto it = mImages.find(static_cast<VkImage>(image));
+
+  if (it == mImages.end() || level >= it->second.mLevels || layer >= it->second.mLayers) {
+    throw std::runtime_error{"Failed to get layout: Subresource is not tracked!"};
+  }
+
+  return it->second.mStates[layer * it->second.mLevels + level].mLayout;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ResourceStateTracker::use(
+  State& state, vk::ImageLayout layout, vk::AccessFlags access, vk::PipelineStageFlags stages) {
+
+  bool writes{access & WRITE_ACCESS};
+  bool transition{layout != state.mLayout};
+  bool merged{state.mPending};
+
+  if (merged) {
+
+    // all uses until the next flush() happen after the queued barrier; it just has to include
+    // this access as well (useImage() ensures that the layout is the same)
+    state.mDstAccess |= access;
+    state.mVisibleAccess |= access;
+    state.mVisibleStages |= stages;
+    mDstStages |= stages;
+
+  } else {
+
+    // a read only needs a barrier if there is a write which has not been made visible to it yet
+    bool hidden{(access & ~state.mVisibleAccess) || (stages & ~state.mVisibleStages)};
+    bool required{transition || (writes && (state.mWriteStages | state.mReadStages)) ||
+                  (state.mWriteStages && hidden)};
+
+    if (required) {
+
+      // reads have to wait for the last write only, writes and transitions for the reads as well
+      vk::PipelineStageFlags srcStages{state.mWriteStages};
+      if (writes || transition) { srcStages |= state.mReadStages; }
+
+      state.mPending   = true;
+      state.mOldLayout = state.mLayout;
+      state.mSrcAccess = state.mWriteAccess;
+      state.mDstAccess = access;
+
+      mSrcStages |= srcStages ? srcStages : vk::PipelineStageFlagBits::eTopOfPipe;
+      mDstStages |= stages;
+
+      // a layout transition behaves like a write which is visible to this access only
+      if (transition) {
+        state.mWriteAccess   = vk::AccessFlags();
+        state.mWriteStages   = stages;
+        state.mReadStages    = vk::PipelineStageFlags();
+        state.mVisibleAccess = vk::AccessFlags();
+        state.mVisibleStages = vk::PipelineStageFlags();
+      }
+
+      state.mVisibleAccess |= access;
+      state.mVisibleStages |= stages;
+    }
+  }
+
+  state.mLayout = layout;
+
+  if (writes && merged) {
+    // this write is not ordered with the other accesses since the last flush()
+    state.mWriteAccess |= access & WRITE_ACCESS;
+    state.mWriteStages |= stages;
+    state.mVisibleAccess = vk::AccessFlags();
+    state.mVisibleStages = vk::PipelineStageFlags();
+  } else if (writes) {
+    state.mWriteAccess   = access & WRITE_ACCESS;
+    state.mWriteStages   = stages;
+    state.mReadStages    = vk::PipelineStageFlags();
+    state.mVisibleAccess = vk::AccessFlags();
+    state.mVisibleStages = vk::PipelineStageFlags();
+  } else {
+    state.mReadStages |= stages;
+  }
+
+  return state.mPending;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
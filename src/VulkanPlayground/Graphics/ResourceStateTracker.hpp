@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_RESOURCE_STATE_TRACKER_HPP
+#define ILLUSION_GRAPHICS_RESOURCE_STATE_TRACKER_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../fwd.hpp"
+
+#include <unordered_map>
+#include <vector>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Tracks the layout and the last accesses of each subresource (mip level and array layer) of     //
+// images and of whole buffers within a stream of recorded commands. Before recording a command,  //
+// useImage() and useBuffer() are called with the layout, access and pipeline stages the command  //
+// requires. The tracker decides whether a barrier is necessary at all (read-after-read is free)  //
+// and queues it; flush() then records all queued barriers with a single pipelineBarrier() call.  //
+// The source stages contain only the stages which actually accessed the resources before, the    //
+// destination stages only the requested ones. Adjacent subresources with equal transitions are   //
+// merged into one barrier.                                                                       //
+// All uses between two calls to flush() are meant for commands recorded after the second one.    //
+// Hence requesting two different layouts for the same subresource in between is an error.        //
+// Queue family ownership transfers are not handled. A tracker is not thread safe, usually there  //
+// is one per command buffer which is recorded.                                                   //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class ResourceStateTracker {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  // Images have to be added before they can be used. The given access and stages describe the last
+  // write to the image which has not been synchronized yet, for example the copy of an upload.
+  void addImage(
+    vk::Image const&       image,
+    uint32_t               levels,
+    uint32_t               layers,
+    vk::ImageAspectFlags   aspect        = vk::ImageAspectFlagBits::eColor,
+    vk::ImageLayout        layout        = vk::ImageLayout::eUndefined,
+    vk::AccessFlags        pendingAccess = vk::AccessFlags(),
+    vk::PipelineStageFlags pendingStages = vk::PipelineStageFlags());
+
+  // Forgets about the resource. This should be called when it is destroyed since the handle value
+  // may be reused.
+  void removeImage(vk::Image const& image);
+  void removeBuffer(vk::Buffer const& buffer);
+
+  // Queues a barrier if the given subresources are not in the requested layout or if their
+  // previous accesses are not yet visible to the given ones. VK_REMAINING_MIP_LEVELS and
+  // VK_REMAINING_ARRAY_LAYERS may be used in the range.
+  void useImage(
+    vk::Image const&                 image,
+    vk::ImageSubresourceRange const& range,
+    vk::ImageLayout                  layout,
+    vk::AccessFlags                  access,
+    vk::PipelineStageFlags           stages);
+
+  // Buffers are tracked as a whole; they are added implicitly on their first use.
+  void useBuffer(vk::Buffer const& buffer, vk::AccessFlags access, vk::PipelineStageFlags stages);
+
+  // Records all queued barriers to the given command buffer. This does nothing if there are none.
+  void flush(vk::CommandBuffer const& commandBuffer);
+
+  bool hasPendingBarriers() const { return mPendingImages.size() + mPendingBuffers.size() > 0; }
+
+  // Returns the layout the subresource has once the queued barriers have been recorded.
+  vk::ImageLayout getLayout(vk::Image const& image, uint32_t level = 0, uint32_t layer = 0) const;
+
+  // Number of pipelineBarrier() calls and of individual barriers since construction.
+  uint64_t getFlushCount() const { return mFlushCount; }
+  uint64_t getBarrierCount() const { return mBarrierCount; }
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct State {
+    vk::ImageLayout mLayout{vk::ImageLayout::eUndefined};
+
+    // the last write and the accesses and stages it has been made visible to
+    vk::AccessFlags        mWriteAccess;
+    vk::PipelineStageFlags mWriteStages;
+    vk::AccessFlags        mVisibleAccess;
+    vk::PipelineStageFlags mVisibleStages;
+
+    // all stages which read since the last write
+    vk::PipelineStageFlags mReadStages;
+
+    // the queued barrier, if any
+    bool            mPending{false};
+    vk::ImageLayout mOldLayout{vk::ImageLayout::eUndefined};
+    vk::AccessFlags mSrcAccess;
+    vk::AccessFlags mDstAccess;
+  };
+
+  struct ImageState {
+    vk::ImageAspectFlags mAspect;
+    uint32_t             mLevels;
+    uint32_t             mLayers;
+
+    // indexed by layer * mLevels + level
+    std::vector<State> mStates;
+
+    // true if it is contained in mPendingImages
+    bool mPending{false};
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  // returns true if a barrier has been queued for the state
+  bool use(
+    State& state, vk::ImageLayout layout, vk::AccessFlags access, vk::PipelineStageFlags stages);
+
+  // ------------------------------------------------------------------------------- private members
+  std::unordered_map<VkImage, ImageState> mImages;
+  std::unordered_map<VkBuffer, State>     mBuffers;
+
+  // resources with queued barriers
+  std::vector<VkImage>  mPendingImages;
+  std::vector<VkBuffer> mPendingBuffers;
+
+  vk::PipelineStageFlags mSrcStages;
+  vk::PipelineStageFlags mDstStages;
+
+  uint64_t mFlushCount{0};
+  uint64_t mBarrierCount{0};
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_RESOURCE_STATE_TRACKER_HPP
@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "SamplerCache.hpp"
+
+#include "../Utils/Hash.hpp"
+#include "../Utils/Logger.hpp"
+#include "VulkanPtr.hpp"
+
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <typename T>
+uint64_t hashMember(T const& member, uint64_t seed) {
+  return hashBytes(&member, sizeof(T), seed);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SamplerCache::SamplerCache(VkDevicePtr const& device, uint32_t maxSamplerCount)
+  : mDevice(device)
+  , mMaxSamplerCount(maxSamplerCount) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t SamplerCache::getHash(vk::SamplerCreateInfo const& info) {
+  // the members are hashed one by one since the padding of the struct is not initialized
+  VkSamplerCreateFlags flags{static_cast<VkSamplerCreateFlags>(info.flags)};
+
+  uint64_t hash{hashBytes(&flags, sizeof(flags))};
+  hash = hashMember(info.magFilter, hash);
+  hash = hashMember(info.minFilter, hash);
+  hash = hashMember(info.mipmapMode, hash);
+  hash = hashMember(info.addressModeU, hash);
+  hash = hashMember(info.addressModeV, hash);
+  hash = hashMember(info.addressModeW, hash);
+  hash = hashMember(info.mipLodBias, hash);
+  hash = hashMember(info.anisotropyEnable, hash);
+  hash = hashMember(info.maxAnisotropy, hash);
+  hash = hashMember(info.compareEnable, hash);
+  hash = hashMember(info.compareOp, hash);
+  hash = hashMember(info.minLod, hash);
+  hash = hashMember(info.maxLod, hash);
+  hash = hashMember(info.borderColor, hash);
+  hash = hashMember(info.unnormalizedCoordinates, hash);
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VkSamplerPtr SamplerCache::get(vk::SamplerCreateInfo const& info) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // extension structs cannot be compared
+  if (info.pNext) {
+    ++mStatistics.mMisses;
+    return create(info);
+  }
+
+  uint64_t hash{getHash(info)};
+  auto     it = mEntries.find(hash);
+
+  if (it != mEntries.end()) {
+    auto sampler = it->second.mSampler.lock();
+
+    if (sampler && it->second.mInfo == info) {
+      ++mStatistics.mHits;
+      return sampler;
+    }
+
+    // the sampler has been destroyed in the meantime or this is a hash collision; in the latter
+    // case the new sampler is not shared
+    if (sampler) {
+      ++mStatistics.mMisses;
+      return create(info);
+    }
+  }
+
+  ++mStatistics.mMisses;
+
+  auto sampler = create(info);
+
+  Entry entry;
+  entry.mInfo    = info;
+  entry.mSampler = sampler;
+
+  mEntries[hash] = entry;
+
+  return sampler;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+SamplerCache::Statistics SamplerCache::getStatistics() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Statistics statistics{mStatistics};
+  statistics.mSamplerCount = 0;
+
+  for (auto const& entry : mEntries) {
+    if (!entry.second.mSampler.expired()) { ++statistics.mSamplerCount; }
+  }
+
+  return statistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SamplerCache::printStatistics() const {
+  auto     statistics = getStatistics();
+  uint32_t requests{statistics.mHits + statistics.mMisses};
+
+  ILLUSION_MESSAGE << "Sampler cache: " << statistics.mHits << " hits, " << statistics.mMisses
+                   << " misses (" << (requests > 0 ? 100.0 * statistics.mHits / requests : 0.0)
+                   << "% hit rate), " << statistics.mSamplerCount << " samplers alive."
+                   << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VkSamplerPtr SamplerCache::create(vk::SamplerCreateInfo const& info) {
+  prune();
+
+  // only the samplers which are shared are counted, so this may miss the limit if there are many
+  // samplers with a pNext chain
+  if (mEntries.size() >= mMaxSamplerCount) {
+    ILLUSION_WARNING << "There are more samplers than the device supports ("
+                     << mMaxSamplerCount << ")!" << std::endl;
+  }
+
+  ILLUSION_DEBUG << "Creating sampler." << std::endl;
+  return makeVulkanPtr(mDevice, mDevice->createSampler(info));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void SamplerCache::prune() {
+  for (auto it = mEntries.begin(); it != mEntries.end();) {
+    if (it->second.mSampler.expired()) {
+      it = mEntries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
@@ -0,0 +1,84 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_SAMPLER_CACHE_HPP
+#define ILLUSION_GRAPHICS_SAMPLER_CACHE_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../fwd.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shares vk::Samplers between all users with equal create infos. The entries are keyed by a      //
+// hash of the members of the vk::SamplerCreateInfo and hold weak references only, so a sampler   //
+// is destroyed once the last user has released it. Device::createVkSampler() goes through this   //
+// cache. Devices may support as few as 4000 samplers (maxSamplerAllocationCount), a warning is   //
+// printed for each sampler beyond this limit. Samplers which are not shared (those with a pNext  //
+// chain or a colliding hash) are not counted, so the warning may come too late for them.         //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class SamplerCache {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  struct Statistics {
+    uint32_t mHits{0};
+    uint32_t mMisses{0};
+
+    // samplers which are currently alive
+    uint32_t mSamplerCount{0};
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  SamplerCache(VkDevicePtr const& device, uint32_t maxSamplerCount);
+
+  // Returns an existing sampler if there is one with an equal create info. This can be called from
+  // multiple threads at once. Create infos with a pNext chain are never shared.
+  VkSamplerPtr get(vk::SamplerCreateInfo const& info);
+
+  Statistics getStatistics() const;
+  void       printStatistics() const;
+
+  // The hash which is used as key. Equal create infos have equal hashes, pNext is ignored.
+  static uint64_t getHash(vk::SamplerCreateInfo const& info);
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct Entry {
+    // used to detect hash collisions
+    vk::SamplerCreateInfo mInfo;
+
+    std::weak_ptr<vk::Sampler> mSampler;
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  VkSamplerPtr create(vk::SamplerCreateInfo const& info);
+
+  // removes the entries of samplers which have been destroyed
+  void prune();
+
+  // ------------------------------------------------------------------------------- private members
+  VkDevicePtr                         mDevice;
+  uint32_t                            mMaxSamplerCount;
+  std::unordered_map<uint64_t, Entry> mEntries;
+
+  Statistics         mStatistics;
+  mutable std::mutex mMutex;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_SAMPLER_CACHE_HPP
@@ -11,6 +11,7 @@
 // ---------------------------------------------------------------------------------------- includes
 #include "ShaderReflection.hpp"
 
+#include <cstring>
 #include <iomanip>
 #include <vulkan/spirv_cpp.hpp>
 #include <vulkan/spirv_glsl.hpp>
@@ -121,6 +122,172 @@ ShaderReflection::BufferRange::BaseType convert(spirv_cross::SPIRType type) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Appends plain values to a byte vector. Everything is stored in host byte order, the serialized
+// reflections are not meant to be shared between machines.
+class Writer {
+ public:
+  void put(uint32_t value) { append(&value, sizeof(uint32_t)); }
+
+  void put(std::string const& value) {
+    put(static_cast<uint32_t>(value.size()));
+    append(value.data(), value.size());
+  }
+
+  void put(vk::ShaderStageFlags value) { put(static_cast<uint32_t>((VkShaderStageFlags)value)); }
+
+  void put(ShaderReflection::BufferRange const& range) {
+    put(static_cast<uint32_t>(range.mBaseType));
+    put(range.mName);
+    put(range.mSize);
+    put(range.mAlignment);
+    put(range.mOffset);
+    put(range.mActiveStages);
+    put(range.mBaseSize);
+    put(range.mElements);
+    put(range.mColumns);
+    put(range.mRows);
+    put(range.mMatrixStride);
+    put(range.mArrayLengths);
+    put(range.mArrayStride);
+    put(range.mTypeName);
+    put(range.mMembers);
+  }
+
+  void put(ShaderReflection::Buffer const& buffer) {
+    put(buffer.mName);
+    put(buffer.mType);
+    put(buffer.mSize);
+    put(buffer.mBinding);
+    put(buffer.mSet);
+    put(buffer.mActiveStages);
+    put(static_cast<uint32_t>(buffer.mPackingStandard));
+    put(buffer.mRanges);
+  }
+
+  void put(ShaderReflection::Sampler const& sampler) {
+    put(sampler.mName);
+    put(sampler.mBinding);
+    put(sampler.mSet);
+    put(sampler.mActiveStages);
+  }
+
+  template <typename T>
+  void put(std::vector<T> const& values) {
+    put(static_cast<uint32_t>(values.size()));
+    for (auto const& value : values) {
+      put(value);
+    }
+  }
+
+  std::vector<uint8_t> mData;
+
+ private:
+  void append(void const* data, size_t size) {
+    auto bytes = static_cast<uint8_t const*>(data);
+    mData.insert(mData.end(), bytes, bytes + size);
+  }
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The counterpart of the Writer. Throws a std::runtime_error if the data ends prematurely.
+class Reader {
+ public:
+  Reader(std::vector<uint8_t> const& data)
+    : mData(data) {}
+
+  void get(uint32_t& value) { extract(&value, sizeof(uint32_t)); }
+
+  void get(std::string& value) {
+    uint32_t size;
+    get(size);
+    check(size);
+    value.assign(reinterpret_cast<char const*>(mData.data() + mOffset), size);
+    mOffset += size;
+  }
+
+  void get(vk::ShaderStageFlags& value) {
+    uint32_t flags;
+    get(flags);
+    value = vk::ShaderStageFlags(vk::ShaderStageFlagBits(flags));
+  }
+
+  void get(ShaderReflection::BufferRange& range) {
+    uint32_t baseType;
+    get(baseType);
+    range.mBaseType = static_cast<ShaderReflection::BufferRange::BaseType>(baseType);
+    get(range.mName);
+    get(range.mSize);
+    get(range.mAlignment);
+    get(range.mOffset);
+    get(range.mActiveStages);
+    get(range.mBaseSize);
+    get(range.mElements);
+    get(range.mColumns);
+    get(range.mRows);
+    get(range.mMatrixStride);
+    get(range.mArrayLengths);
+    get(range.mArrayStride);
+    get(range.mTypeName);
+    get(range.mMembers);
+  }
+
+  void get(ShaderReflection::Buffer& buffer) {
+    get(buffer.mName);
+    get(buffer.mType);
+    get(buffer.mSize);
+    get(buffer.mBinding);
+    get(buffer.mSet);
+    get(buffer.mActiveStages);
+    uint32_t packingStandard;
+    get(packingStandard);
+    buffer.mPackingStandard =
+      static_cast<ShaderReflection::Buffer::PackingStandard>(packingStandard);
+    get(buffer.mRanges);
+  }
+
+  void get(ShaderReflection::Sampler& sampler) {
+    get(sampler.mName);
+    get(sampler.mBinding);
+    get(sampler.mSet);
+    get(sampler.mActiveStages);
+  }
+
+  template <typename T>
+  void get(std::vector<T>& values) {
+    uint32_t size;
+    get(size);
+
+    // each element takes at least four bytes - this prevents huge allocations for corrupt data
+    check(static_cast<size_t>(size) * sizeof(uint32_t));
+    values.resize(size);
+
+    for (auto& value : values) {
+      get(value);
+    }
+  }
+
+  bool isAtEnd() const { return mOffset == mData.size(); }
+
+ private:
+  void check(size_t size) const {
+    if (mData.size() - mOffset < size) {
+      throw std::runtime_error{"Serialized shader reflection is truncated!"};
+    }
+  }
+
+  void extract(void* data, size_t size) {
+    check(size);
+    std::memcpy(data, mData.data() + mOffset, size);
+    mOffset += size;
+  }
+
+  std::vector<uint8_t> const& mData;
+  size_t                      mOffset{0};
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 }
 
@@ -337,6 +504,41 @@ ShaderReflection::ShaderReflection(std::vector<ShaderReflection> const& stages)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+ShaderReflectionPtr ShaderReflection::deserialize(std::vector<uint8_t> const& data) {
+  ShaderReflectionPtr result{new ShaderReflection()};
+  Reader              reader{data};
+
+  reader.get(result->mStages);
+  reader.get(result->mPushConstantBuffers);
+  reader.get(result->mUniformBuffers);
+  reader.get(result->mSamplers);
+  reader.get(result->mInputs);
+  reader.get(result->mOutputs);
+
+  if (!reader.isAtEnd()) {
+    throw std::runtime_error{"Serialized shader reflection has trailing data!"};
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint8_t> ShaderReflection::serialize() const {
+  Writer writer;
+
+  writer.put(mStages);
+  writer.put(mPushConstantBuffers);
+  writer.put(mUniformBuffers);
+  writer.put(mSamplers);
+  writer.put(mInputs);
+  writer.put(mOutputs);
+
+  return writer.mData;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void ShaderReflection::merge(ShaderReflection const& stage) {
 
   // check that we do not have such a stage already
@@ -127,6 +127,13 @@ class ShaderReflection {
   ShaderReflection(std::vector<ShaderReflection> const& stages);
   ShaderReflection(std::vector<ShaderReflectionPtr> const& stages);
 
+  // Creates a reflection from the output of serialize(). Throws a std::runtime_error if the data
+  // is malformed.
+  static ShaderReflectionPtr deserialize(std::vector<uint8_t> const& data);
+
+  // Returns a compact binary representation of all buffers, samplers, inputs, outputs and stages.
+  std::vector<uint8_t> serialize() const;
+
   std::string toInfoString() const;
   std::string toCppString() const;
   std::string toGlslString() const;
@@ -139,6 +146,9 @@ class ShaderReflection {
 
  private:
   // ------------------------------------------------------------------------------- private methods
+  // used by deserialize()
+  ShaderReflection() = default;
+
   void merge(ShaderReflection const& stage);
 
   // ------------------------------------------------------------------------------- private members
@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "ShaderReflectionCache.hpp"
+
+#include "../Utils/Hash.hpp"
+#include "../Utils/Logger.hpp"
+#include "ShaderReflection.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// "ILRC" in little endian
+const uint32_t FILE_MAGIC{0x43524c49};
+
+// this has to be increased whenever the serialization of the ShaderReflection changes
+const uint32_t FILE_VERSION{2};
+
+// seed of the second code hash; any value other than the default seed of hashBytes() will do
+const uint64_t CODE_CHECK_SEED{0x9e3779b97f4a7c15ull};
+
+// this precedes the serialized reflection of each entry
+struct EntryHeader {
+  uint64_t mKey;
+  uint64_t mCodeSize;
+  uint64_t mCodeCheck;
+  uint64_t mDataSize;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double getMilliseconds(std::chrono::steady_clock::time_point const& start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+    .count();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ShaderReflectionCache::ShaderReflectionCache(std::string const& fileName)
+  : mFile(fileName, FILE_MAGIC, FILE_VERSION, "shader reflection cache") {
+
+  ILLUSION_DEBUG << "Creating shader reflection cache." << std::endl;
+  load();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ShaderReflectionCache::~ShaderReflectionCache() {
+  if (mIsDirty) { save(); }
+  ILLUSION_DEBUG << "Deleting shader reflection cache." << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ShaderReflectionPtr ShaderReflectionCache::get(Span<uint32_t const> code) {
+  auto     start = std::chrono::steady_clock::now();
+  uint64_t key{hashBytes(code.data(), code.sizeInBytes())};
+  uint64_t check{hashBytes(code.data(), code.sizeInBytes(), CODE_CHECK_SEED)};
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mEntries.find(key);
+    if (
+      it != mEntries.end() && it->second.mCodeSize == code.size() &&
+      it->second.mCodeCheck == check) {
+      try {
+        if (!it->second.mReflection) {
+          it->second.mReflection = ShaderReflection::deserialize(it->second.mData);
+        }
+
+        ++mStatistics.mHits;
+        mStatistics.mHitTime += getMilliseconds(start);
+
+        return it->second.mReflection;
+      } catch (std::runtime_error const& e) {
+        ILLUSION_WARNING << "Discarding cached shader reflection: " << e.what() << std::endl;
+        mEntries.erase(it);
+      }
+    }
+  }
+
+  // this is the expensive part, several threads may do this at once
+  auto reflection{
+    std::make_shared<ShaderReflection>(std::vector<uint32_t>(code.begin(), code.end()))};
+
+  Entry entry;
+  entry.mCodeSize   = code.size();
+  entry.mCodeCheck  = check;
+  entry.mData       = reflection->serialize();
+  entry.mReflection = reflection;
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  mEntries[key] = std::move(entry);
+  mIsDirty      = true;
+
+  ++mStatistics.mMisses;
+  mStatistics.mMissTime += getMilliseconds(start);
+
+  return reflection;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool ShaderReflectionCache::save() const {
+  if (mFile.getFileName().empty()) { return false; }
+
+  std::vector<uint8_t> data;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto const& entry : mEntries) {
+      EntryHeader header;
+      header.mKey       = entry.first;
+      header.mCodeSize  = entry.second.mCodeSize;
+      header.mCodeCheck = entry.second.mCodeCheck;
+      header.mDataSize  = entry.second.mData.size();
+
+      size_t offset{data.size()};
+      data.resize(offset + sizeof(EntryHeader) + entry.second.mData.size());
+      std::memcpy(data.data() + offset, &header, sizeof(EntryHeader));
+      std::memcpy(
+        data.data() + offset + sizeof(EntryHeader),
+        entry.second.mData.data(),
+        entry.second.mData.size());
+    }
+  }
+
+  return mFile.save(data);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ShaderReflectionCache::Statistics ShaderReflectionCache::getStatistics() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mStatistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ShaderReflectionCache::printStatistics() const {
+  auto statistics = getStatistics();
+
+  ILLUSION_MESSAGE << "Shader reflection cache: " << statistics.mHits << " hits ("
+                   << (statistics.mHits > 0 ? statistics.mHitTime / statistics.mHits : 0.0)
+                   << " ms avg), " << statistics.mMisses << " misses ("
+                   << (statistics.mMisses > 0 ? statistics.mMissTime / statistics.mMisses : 0.0)
+                   << " ms avg)." << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ShaderReflectionCache::load() {
+  auto content = mFile.load();
+  if (content.empty()) { return; }
+
+  uint8_t const* data{content.data()};
+  size_t         size{content.size()};
+
+  // the hash matched, so the entries are well-formed unless the file was written by a broken
+  // version - the bounds are checked anyways
+  size_t offset{0};
+  while (offset + sizeof(EntryHeader) <= size) {
+    EntryHeader entryHeader;
+    std::memcpy(&entryHeader, data + offset, sizeof(EntryHeader));
+    offset += sizeof(EntryHeader);
+
+    if (entryHeader.mDataSize > size - offset) { break; }
+
+    Entry entry;
+    entry.mCodeSize  = entryHeader.mCodeSize;
+    entry.mCodeCheck = entryHeader.mCodeCheck;
+    entry.mData.assign(data + offset, data + offset + entryHeader.mDataSize);
+    offset += entryHeader.mDataSize;
+
+    mEntries[entryHeader.mKey] = std::move(entry);
+  }
+
+  if (offset != size) {
+    ILLUSION_WARNING << "Discarding shader reflection cache \"" << mFile.getFileName()
+                     << "\": Entries are malformed." << std::endl;
+    mEntries.clear();
+    return;
+  }
+
+  ILLUSION_DEBUG << "Loaded shader reflection cache \"" << mFile.getFileName() << "\" ("
+                 << mEntries.size() << " entries)." << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
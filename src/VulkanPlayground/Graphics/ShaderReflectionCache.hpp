@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_SHADER_REFLECTION_CACHE_HPP
+#define ILLUSION_GRAPHICS_SHADER_REFLECTION_CACHE_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../Utils/CacheFile.hpp"
+#include "../Utils/Span.hpp"
+#include "../fwd.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stores the ShaderReflection of each SPIR-V module in its serialized form, keyed by a hash of   //
+// the SPIR-V words. get() only runs spirv_cross for modules which are not in the cache yet. The  //
+// cache is loaded from a file on construction and written back on destruction if new modules     //
+// have been added. Like the PipelineCache, the file is read and written by a CacheFile.          //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class ShaderReflectionCache {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  struct Statistics {
+    uint32_t mHits{0};
+    uint32_t mMisses{0};
+
+    // accumulated reflection times in milliseconds
+    double mHitTime{0.0};
+    double mMissTime{0.0};
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  // If fileName is empty, the cache is neither loaded nor saved.
+  ShaderReflectionCache(std::string const& fileName);
+  virtual ~ShaderReflectionCache();
+
+  // Returns the reflection of the given SPIR-V module. This can be called from multiple threads at
+  // once; spirv_cross runs without holding the lock.
+  ShaderReflectionPtr get(Span<uint32_t const> code);
+
+  // Writes the cache to disk. The file is replaced atomically.
+  bool save() const;
+
+  Statistics getStatistics() const;
+  void       printStatistics() const;
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct Entry {
+    // The entries are keyed by a 64 bit hash of the SPIR-V words. On lookup, the size and a second
+    // hash of the words with another seed have to match as well, so a collision of the key alone
+    // does not return the reflection of another module. If both hashes collide, it still does.
+    uint64_t mCodeSize{0};
+    uint64_t mCodeCheck{0};
+
+    std::vector<uint8_t> mData;
+
+    // created from mData on first use
+    ShaderReflectionPtr mReflection;
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  void load();
+
+  // ------------------------------------------------------------------------------- private members
+  CacheFile                           mFile;
+  std::unordered_map<uint64_t, Entry> mEntries;
+  bool                                mIsDirty{false};
+
+  Statistics         mStatistics;
+  mutable std::mutex mMutex;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_SHADER_REFLECTION_CACHE_HPP
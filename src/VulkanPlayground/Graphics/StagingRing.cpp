@@ -0,0 +1,189 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "StagingRing.hpp"
+
+#include "../Utils/Logger.hpp"
+#include "Device.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StagingRing::StagingRing(
+  VkDevicePtr const&                            device,
+  BufferPtr const&                              buffer,
+  std::function<BufferPtr(vk::DeviceSize size)> fallback)
+  : mDevice(device)
+  , mBuffer(buffer)
+  , mCapacity(buffer->mSize)
+  , mFallback(fallback) {
+
+  if (!mBuffer->mMappedData) {
+    throw std::runtime_error{"Failed to create staging ring: Buffer is not persistently mapped!"};
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StagingRing::Region StagingRing::allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Region region;
+  region.mSize = size;
+
+  // empty regions would make it impossible to distinguish a full ring from an empty one
+  size = std::max<vk::DeviceSize>(1, size);
+
+  if (size < mCapacity) {
+    reclaim(false);
+
+    vk::DeviceSize offset;
+    bool           success{tryAllocate(size, alignment, offset)};
+
+    // all in-flight regions belong to batches which have been submitted already - wait for the
+    // oldest of them to finish
+    while (!success && !mPendingBatches.empty()) {
+      ++mStallCount;
+      reclaim(true);
+      success = tryAllocate(size, alignment, offset);
+    }
+
+    if (success) {
+      mOpenBatchIsEmpty = false;
+      region.mBuffer    = mBuffer;
+      region.mOffset    = offset;
+      region.mData      = mBuffer->mMappedData + offset;
+      return region;
+    }
+  }
+
+  // the upload is either larger than the entire ring or the ring is filled up by regions which have
+  // not been retired yet - waiting would dead-lock in this case
+  ILLUSION_DEBUG << "Creating temporary staging buffer of " << size << " bytes." << std::endl;
+
+  ++mFallbackCount;
+  region.mBuffer = mFallback(size);
+  region.mOffset = 0;
+  region.mData   = region.mBuffer->mMappedData;
+
+  mOpenFallbackBuffers.push_back(region.mBuffer);
+
+  return region;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StagingRing::isBlockedByOpenRegions(vk::DeviceSize size, vk::DeviceSize alignment) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  size = std::max<vk::DeviceSize>(1, size);
+
+  if (size >= mCapacity || mOpenBatchIsEmpty) { return false; }
+
+  // once all retired batches have finished, only the open regions are still in use
+  vk::DeviceSize tail{mPendingBatches.empty() ? mTail : mPendingBatches.back().mEnd};
+  vk::DeviceSize offset;
+
+  return !findOffset(size, alignment, tail, offset);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StagingRing::retire(VkFencePtr const& fence) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (mOpenBatchIsEmpty && mOpenFallbackBuffers.empty()) { return; }
+
+  Batch batch;
+  batch.mEnd   = mHead;
+  batch.mFence = fence;
+  batch.mFallbackBuffers.swap(mOpenFallbackBuffers);
+
+  mPendingBatches.push_back(batch);
+  mOpenBatchIsEmpty = true;
+
+  reclaim(false);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StagingRing::reclaim(bool wait) {
+  if (wait && !mPendingBatches.empty() && mPendingBatches.front().mFence) {
+    mDevice->waitForFences(*mPendingBatches.front().mFence, true, ~0);
+  }
+
+  while (!mPendingBatches.empty()) {
+    auto const& batch = mPendingBatches.front();
+
+    if (batch.mFence && mDevice->getFenceStatus(*batch.mFence) != vk::Result::eSuccess) { break; }
+
+    mTail = batch.mEnd;
+    mPendingBatches.pop_front();
+  }
+
+  // start from the beginning again if the ring is empty to reduce wrapping
+  if (mPendingBatches.empty() && mOpenBatchIsEmpty) { mHead = mTail = 0; }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StagingRing::tryAllocate(
+  vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset) {
+
+  if (!findOffset(size, alignment, mTail, offset)) { return false; }
+
+  mHead = offset + size;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool StagingRing::findOffset(
+  vk::DeviceSize  size,
+  vk::DeviceSize  alignment,
+  vk::DeviceSize  tail,
+  vk::DeviceSize& offset) const {
+
+  vk::DeviceSize start{(mHead + alignment - 1) / alignment * alignment};
+
+  // the regions in use do not wrap around, there is free space at the end and at the beginning
+  if (mHead >= tail) {
+    if (start + size <= mCapacity) {
+      offset = start;
+      return true;
+    }
+
+    // the head must never catch up with the tail, else we could not tell a full ring from an empty
+    // one
+    if (size < tail) {
+      offset = 0;
+      return true;
+    }
+
+    return false;
+  }
+
+  // the regions in use wrap around, there is free space between head and tail
+  if (start + size < tail) {
+    offset = start;
+    return true;
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
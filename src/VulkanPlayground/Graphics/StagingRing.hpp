@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_STAGING_RING_HPP
+#define ILLUSION_GRAPHICS_STAGING_RING_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../fwd.hpp"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A persistently mapped, host visible buffer which is used as a ring for all uploads of a        //
+// Device. Regions are handed out in order; once the commands reading from them have been         //
+// submitted, retire() tags all regions handed out since the last call with a fence. These        //
+// regions are reused as soon as the fence is signaled. If the ring is full, allocate() blocks on //
+// the oldest fence. Uploads larger than the ring get a temporary buffer of their own.            //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class StagingRing {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  struct Region {
+    // this is either the ring buffer or a dedicated buffer for large uploads
+    BufferPtr      mBuffer;
+    vk::DeviceSize mOffset{0};
+    vk::DeviceSize mSize{0};
+    uint8_t*       mData{nullptr};
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  // The buffer has to be created with Device::createMappedBuffer(). The fallback is used to create
+  // temporary mapped buffers for uploads which do not fit into the ring.
+  StagingRing(
+    VkDevicePtr const&                            device,
+    BufferPtr const&                              buffer,
+    std::function<BufferPtr(vk::DeviceSize size)> fallback);
+
+  // The returned region may be written to until it is passed to a command buffer and retire() is
+  // called.
+  Region allocate(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+  // Returns true if allocate() would have to create a temporary buffer because the ring is filled
+  // up by regions which have not been retired yet. The caller should submit and retire them first;
+  // allocate() then waits for their fence instead.
+  bool isBlockedByOpenRegions(vk::DeviceSize size, vk::DeviceSize alignment = 16);
+
+  // All regions allocated since the last call become reusable once the given fence is signaled.
+  // Pass nullptr if the corresponding commands are known to have finished already.
+  void retire(VkFencePtr const& fence);
+
+  vk::DeviceSize getCapacity() const { return mCapacity; }
+  uint64_t       getFallbackCount() const { return mFallbackCount; }
+  uint64_t       getStallCount() const { return mStallCount; }
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct Batch {
+    vk::DeviceSize         mEnd;
+    VkFencePtr             mFence;
+    std::vector<BufferPtr> mFallbackBuffers;
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  void reclaim(bool wait);
+  bool tryAllocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize& offset);
+
+  // finds room for the region assuming that everything before the given tail has been reclaimed
+  bool findOffset(
+    vk::DeviceSize  size,
+    vk::DeviceSize  alignment,
+    vk::DeviceSize  tail,
+    vk::DeviceSize& offset) const;
+
+  // ------------------------------------------------------------------------------- private members
+  VkDevicePtr                                   mDevice;
+  BufferPtr                                     mBuffer;
+  vk::DeviceSize                                mCapacity;
+  std::function<BufferPtr(vk::DeviceSize size)> mFallback;
+
+  // regions between mTail and mHead are in use
+  vk::DeviceSize mHead{0};
+  vk::DeviceSize mTail{0};
+
+  std::deque<Batch>      mPendingBatches;
+  bool                   mOpenBatchIsEmpty{true};
+  std::vector<BufferPtr> mOpenFallbackBuffers;
+
+  uint64_t mFallbackCount{0};
+  uint64_t mStallCount{0};
+
+  std::mutex mMutex;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_STAGING_RING_HPP
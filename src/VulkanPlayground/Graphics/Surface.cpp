@@ -12,9 +12,11 @@
 #include "Surface.hpp"
 
 #include "../Utils/Logger.hpp"
+#include "../Utils/Profiler.hpp"
 #include "../Utils/ScopedTimer.hpp"
 #include "Device.hpp"
 #include "Framebuffer.hpp"
+#include "GpuProfiler.hpp"
 #include "Instance.hpp"
 #include "PhysicalDevice.hpp"
 
@@ -83,7 +85,7 @@ vk::Extent2D chooseExtent(vk::SurfaceCapabilitiesKHR const& available) {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-Surface::Surface(DevicePtr const& device, GLFWwindow* window)
+Surface::Surface(DevicePtr const& device, GLFWwindow* window, uint32_t framesInFlight)
   : mDevice(device) {
 
   mSurface = device->getInstance()->createVkSurface(window);
@@ -91,18 +93,51 @@ Surface::Surface(DevicePtr const& device, GLFWwindow* window)
   createSwapChain();
   createRenderPass();
   createFramebuffers();
-  createSemaphores();
-  createCommandBuffers();
+  createFrameResources(framesInFlight);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Surface::Surface(DevicePtr const& device, vk::Extent2D const& extent, uint32_t framesInFlight)
+  : mDevice(device)
+  , mImageCount(framesInFlight)
+  , mImageFormat(vk::Format::eR8G8B8A8Unorm)
+  , mExtent(extent) {
+
+  createOffscreenImages();
+  createRenderPass();
+  createFramebuffers();
+  createFrameResources(framesInFlight);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 FrameInfo Surface::beginFrame() {
-  uint32_t imageIndex;
-  auto     result = mDevice->getVkDevice()->acquireNextImageKHR(
+  ILLUSION_PROFILE_ZONE("Surface::beginFrame");
+
+  // this is called again if the swap chain had to be recreated, that still counts as one frame
+  if (mFrameStartTime == 0) { mFrameStartTime = Profiler::now(); }
+
+  auto const& frame = mFrameResources[mCurrentFrame];
+
+  // wait until the GPU has finished the last frame which used these resources
+  {
+    ILLUSION_PROFILE_ZONE("Surface::waitForFrame");
+    mDevice->getVkDevice()->waitForFences(*frame.mFence, true, ~0);
+  }
+
+  uint32_t imageIndex{mCurrentFrame};
+
+  // there is one offscreen image per frame in flight, so it is not in use anymore
+  if (isHeadless()) {
+    mDevice->getVkDevice()->resetFences(*frame.mFence);
+    return beginCommandBuffer(frame, imageIndex);
+  }
+
+  auto result = mDevice->getVkDevice()->acquireNextImageKHR(
     *mSwapChain,
     std::numeric_limits<uint64_t>::max(),
-    *mImageAvailableSemaphore,
+    *frame.mImageAvailableSemaphore,
     nullptr,
     &imageIndex);
 
@@ -115,16 +150,51 @@ FrameInfo Surface::beginFrame() {
     ILLUSION_ERROR << "Suboptimal swap chain!" << std::endl;
   }
 
-  vk::CommandBufferBeginInfo beginInfo;
-  beginInfo.flags = vk::CommandBufferUsageFlagBits::eSimultaneousUse;
-  mDevice->getVkDevice()->waitForFences(*mFences[imageIndex], true, ~0);
+  // the image may be returned out of order and still be in use by another frame in flight
+  if (mImagesInFlight[imageIndex] && mImagesInFlight[imageIndex] != *frame.mFence) {
+    mDevice->getVkDevice()->waitForFences(mImagesInFlight[imageIndex], true, ~0);
+  }
 
-  vk::CommandBuffer buffer = mPrimaryCommandBuffers[imageIndex];
-  mDevice->getVkDevice()->resetFences(*mFences[imageIndex]);
+  mImagesInFlight[imageIndex] = *frame.mFence;
 
+  mDevice->getVkDevice()->resetFences(*frame.mFence);
+
+  return beginCommandBuffer(frame, imageIndex);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameInfo Surface::beginCommandBuffer(FrameResources const& frame, uint32_t imageIndex) {
+  vk::CommandBufferBeginInfo beginInfo;
+  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+  vk::CommandBuffer buffer = frame.mPrimaryCommandBuffer;
   buffer.reset(vk::CommandBufferResetFlags());
   buffer.begin(beginInfo);
 
+  // the fence of this frame has been waited for, so the previous results are available
+  mGpuProfiler->beginFrame(buffer, mCurrentFrame);
+
+  // everything since the beginning of beginFrame() has been spent waiting for the frame resources
+  // and the swap chain image
+  uint64_t now{Profiler::now()};
+  mFrameStatistics->add(FrameStatistics::Metric::eAcquireWait, (now - mFrameStartTime) * 1e-6);
+
+  if (mLastFrameStartTime != 0) {
+    mFrameStatistics->add(
+      FrameStatistics::Metric::eCpuFrameTime, (mFrameStartTime - mLastFrameStartTime) * 1e-6);
+  }
+
+  mLastFrameStartTime = mFrameStartTime;
+  mFrameStartTime     = 0;
+
+  // each frame is reported once, when its frame index is used again
+  auto const& gpuFrame = mGpuProfiler->getLastFrame();
+  if (gpuFrame.mIsValid && gpuFrame.mFrameNumber >= mNextGpuFrameNumber) {
+    mFrameStatistics->add(FrameStatistics::Metric::eGpuFrameTime, gpuFrame.mMilliseconds);
+    mNextGpuFrameNumber = gpuFrame.mFrameNumber + 1;
+  }
+
   // Update dynamic viewport state
   vk::Viewport viewport;
   viewport.height   = (float)mExtent.height;
@@ -141,7 +211,11 @@ FrameInfo Surface::beginFrame() {
   scissor.offset.y      = 0;
   buffer.setScissor(0, 1, &scissor);
 
-  return {buffer, imageIndex};
+  FrameInfo info{buffer, imageIndex, mCurrentFrame};
+
+  mCurrentFrame = (mCurrentFrame + 1) % mFrameResources.size();
+
+  return info;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -170,11 +244,35 @@ void Surface::endRenderPass(FrameInfo const& info) const {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void Surface::endFrame(FrameInfo const& info) const {
+  ILLUSION_PROFILE_ZONE("Surface::endFrame");
+
+  mGpuProfiler->endFrame(info.mPrimaryCommandBuffer);
   info.mPrimaryCommandBuffer.end();
 
+  // resources which are used by this frame may still have pending uploads
+  mDevice->flushUploads();
+
+  auto const& frame = mFrameResources[info.mFrameIndex];
+
+  // offscreen frames neither wait for an image nor have to signal the presentation
+  if (isHeadless()) {
+    vk::SubmitInfo submitInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers    = &info.mPrimaryCommandBuffer;
+
+    {
+      std::lock_guard<std::mutex> lock(mDevice->getQueueMutex());
+      mDevice->getVkGraphicsQueue().submit(submitInfo, *frame.mFence);
+    }
+
+    mFrameStatistics->finishFrame();
+
+    return;
+  }
+
   vk::PipelineStageFlags waitStages[]       = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
-  vk::Semaphore          waitSemaphores[]   = {*mImageAvailableSemaphore};
-  vk::Semaphore          signalSemaphores[] = {*mRenderFinishedSemaphore};
+  vk::Semaphore          waitSemaphores[]   = {*frame.mImageAvailableSemaphore};
+  vk::Semaphore          signalSemaphores[] = {*frame.mRenderFinishedSemaphore};
 
   vk::SubmitInfo submitInfo;
   submitInfo.waitSemaphoreCount   = 1;
@@ -185,7 +283,10 @@ void Surface::endFrame(FrameInfo const& info) const {
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores    = signalSemaphores;
 
-  mDevice->getVkGraphicsQueue().submit(submitInfo, *mFences[info.mSwapChainImageIndex]);
+  {
+    std::lock_guard<std::mutex> lock(mDevice->getQueueMutex());
+    mDevice->getVkGraphicsQueue().submit(submitInfo, *frame.mFence);
+  }
 
   vk::SwapchainKHR swapChains[] = {*mSwapChain};
 
@@ -196,7 +297,18 @@ void Surface::endFrame(FrameInfo const& info) const {
   presentInfo.pSwapchains        = swapChains;
   presentInfo.pImageIndices      = &info.mSwapChainImageIndex;
 
-  auto result = mDevice->getVkPresentQueue().presentKHR(presentInfo);
+  uint64_t   presentStart{Profiler::now()};
+  vk::Result result;
+
+  {
+    std::lock_guard<std::mutex> lock(mDevice->getQueueMutex());
+    result = mDevice->getVkPresentQueue().presentKHR(presentInfo);
+  }
+
+  mFrameStatistics->add(
+    FrameStatistics::Metric::ePresentWait, (Profiler::now() - presentStart) * 1e-6);
+  mFrameStatistics->finishFrame();
+
   if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR) {
     ILLUSION_ERROR << "out of date 3!" << std::endl;
   } else if (result != vk::Result::eSuccess) {
@@ -209,9 +321,17 @@ void Surface::endFrame(FrameInfo const& info) const {
 void Surface::recreate() {
   mDevice->getVkDevice()->waitIdle();
 
-  createSwapChain();
+  if (isHeadless()) {
+    createOffscreenImages();
+  } else {
+    createSwapChain();
+  }
+
   createRenderPass();
   createFramebuffers();
+
+  // all frames have finished after waitIdle()
+  mImagesInFlight.assign(mFramebuffers.size(), vk::Fence());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -278,14 +398,40 @@ void Surface::createSwapChain() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void Surface::createOffscreenImages() {
+  // delete old images first
+  mOffscreenImages.clear();
+
+  for (uint32_t i = 0; i < mImageCount; ++i) {
+    mOffscreenImages.push_back(mDevice->createImage(
+      mExtent.width,
+      mExtent.height,
+      1,
+      mImageFormat,
+      vk::ImageTiling::eOptimal,
+      vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+      vk::MemoryPropertyFlagBits::eDeviceLocal));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Surface::createFramebuffers() {
 
   // delete old frame buffers first
   mFramebuffers.clear();
 
-  auto swapChainImages = mDevice->getVkDevice()->getSwapchainImagesKHR(*mSwapChain);
+  std::vector<vk::Image> images;
 
-  for (auto const& image : swapChainImages) {
+  if (isHeadless()) {
+    for (auto const& image : mOffscreenImages) {
+      images.push_back(*image->mImage);
+    }
+  } else {
+    images = mDevice->getVkDevice()->getSwapchainImagesKHR(*mSwapChain);
+  }
+
+  for (auto const& image : images) {
     mFramebuffers.push_back(Framebuffer(mDevice, mRenderPass, image, mExtent, mImageFormat));
   }
 }
@@ -304,7 +450,8 @@ void Surface::createRenderPass() {
   colorAttachment.stencilLoadOp  = vk::AttachmentLoadOp::eDontCare;
   colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
   colorAttachment.initialLayout  = vk::ImageLayout::eUndefined;
-  colorAttachment.finalLayout    = vk::ImageLayout::ePresentSrcKHR;
+  colorAttachment.finalLayout =
+    isHeadless() ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
 
   vk::AttachmentReference colorAttachmentRef;
   colorAttachmentRef.attachment = 0;
@@ -337,27 +484,37 @@ void Surface::createRenderPass() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Surface::createSemaphores() {
-  vk::SemaphoreCreateInfo info;
-  mImageAvailableSemaphore = mDevice->createVkSemaphore(info);
-  mRenderFinishedSemaphore = mDevice->createVkSemaphore(info);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////
+void Surface::createFrameResources(uint32_t framesInFlight) {
+  if (framesInFlight == 0) {
+    throw std::runtime_error{"Failed to create surface: At least one frame in flight is required!"};
+  }
 
-void Surface::createCommandBuffers() {
   vk::CommandBufferAllocateInfo allocInfo;
   allocInfo.commandPool        = *mDevice->getVkCommandPool();
   allocInfo.level              = vk::CommandBufferLevel::ePrimary;
-  allocInfo.commandBufferCount = mImageCount;
+  allocInfo.commandBufferCount = framesInFlight;
 
-  mPrimaryCommandBuffers = mDevice->getVkDevice()->allocateCommandBuffers(allocInfo);
+  auto commandBuffers = mDevice->getVkDevice()->allocateCommandBuffers(allocInfo);
 
-  for (uint32_t i = 0; i < mImageCount; ++i) {
-    vk::FenceCreateInfo info;
-    info.flags = vk::FenceCreateFlagBits::eSignaled;
-    mFences.push_back(mDevice->createVkFence(info));
+  for (uint32_t i = 0; i < framesInFlight; ++i) {
+    FrameResources frame;
+    frame.mPrimaryCommandBuffer = commandBuffers[i];
+
+    vk::FenceCreateInfo fenceInfo;
+    fenceInfo.flags = vk::FenceCreateFlagBits::eSignaled;
+    frame.mFence    = mDevice->createVkFence(fenceInfo);
+
+    vk::SemaphoreCreateInfo semaphoreInfo;
+    frame.mImageAvailableSemaphore = mDevice->createVkSemaphore(semaphoreInfo);
+    frame.mRenderFinishedSemaphore = mDevice->createVkSemaphore(semaphoreInfo);
+
+    mFrameResources.push_back(std::move(frame));
   }
+
+  mImagesInFlight.assign(mFramebuffers.size(), vk::Fence());
+
+  mGpuProfiler     = std::make_shared<GpuProfiler>(mDevice, framesInFlight);
+  mFrameStatistics = std::make_shared<FrameStatistics>();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -12,6 +12,7 @@
 #define ILLUSION_GRAPHICS_SURFACE_HPP
 
 // ---------------------------------------------------------------------------------------- includes
+#include "../Utils/FrameStatistics.hpp"
 #include "Device.hpp"
 
 struct GLFWwindow;
@@ -22,6 +23,9 @@ namespace Graphics {
 struct FrameInfo {
   vk::CommandBuffer mPrimaryCommandBuffer;
   uint32_t          mSwapChainImageIndex;
+
+  // in [0, Surface::getFramesInFlight()); use this to index per-frame resources
+  uint32_t mFrameIndex;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -32,7 +36,14 @@ class Surface {
 
  public:
   // -------------------------------------------------------------------------------- public methods
-  Surface(DevicePtr const& device, GLFWwindow* window);
+  // Up to framesInFlight frames are recorded on the CPU while the GPU is still busy with the
+  // previous ones. This is independent of the number of swap chain images.
+  Surface(DevicePtr const& device, GLFWwindow* window, uint32_t framesInFlight = 2);
+
+  // Creates a headless surface which renders into a pool of offscreen images, one for each frame
+  // in flight. There is no presentation; after endFrame() the image of the frame is in
+  // eTransferSrcOptimal layout and can be read back. This works with headless instances.
+  Surface(DevicePtr const& device, vk::Extent2D const& extent, uint32_t framesInFlight = 2);
 
   FrameInfo beginFrame();
   void beginRenderPass(FrameInfo const& info) const;
@@ -44,27 +55,60 @@ class Surface {
   vk::Extent2D const&             getExtent() const { return mExtent; }
   VkRenderPassPtr const&          getRenderPass() const { return mRenderPass; }
   uint32_t                        getImageCount() const { return mImageCount; }
+  uint32_t                        getFramesInFlight() const { return mFrameResources.size(); }
   std::vector<Framebuffer> const& getFramebuffers() const { return mFramebuffers; }
 
+  // Measures each frame; add zones with ILLUSION_GPU_PROFILE_ZONE.
+  GpuProfilerPtr const& getGpuProfiler() const { return mGpuProfiler; }
+
+  // Rolling windows of the CPU and GPU frame times and of the time spent waiting for images and
+  // in presentation. These are recorded for every frame.
+  FrameStatisticsPtr const& getFrameStatistics() const { return mFrameStatistics; }
+
+  bool isHeadless() const { return !mSurface; }
+
+  // only available for headless surfaces, indexed by FrameInfo::mSwapChainImageIndex
+  std::vector<ImagePtr> const& getOffscreenImages() const { return mOffscreenImages; }
+
  private:
   // ------------------------------------------------------------------------------- private methods
   void createSwapChain();
+  void createOffscreenImages();
   void createFramebuffers();
   void createRenderPass();
-  void createSemaphores();
-  void createCommandBuffers();
+  void createFrameResources(uint32_t framesInFlight);
+
+  // ------------------------------------------------------------------------------- private classes
+  struct FrameResources {
+    vk::CommandBuffer mPrimaryCommandBuffer;
+    VkFenceHandle     mFence;
+    VkSemaphoreHandle mImageAvailableSemaphore;
+    VkSemaphoreHandle mRenderFinishedSemaphore;
+  };
+
+  // resets and begins the command buffer of the frame and sets the dynamic state
+  FrameInfo beginCommandBuffer(FrameResources const& frame, uint32_t imageIndex);
 
   // ------------------------------------------------------------------------------- private members
   DevicePtr mDevice;
 
   VkSurfaceKHRPtr mSurface;
-  VkSemaphorePtr  mImageAvailableSemaphore;
-  VkSemaphorePtr  mRenderFinishedSemaphore;
 
-  std::vector<vk::CommandBuffer> mPrimaryCommandBuffers;
-  std::vector<VkFencePtr>        mFences;
+  std::vector<FrameResources> mFrameResources;
+  uint32_t                    mCurrentFrame{0};
+  GpuProfilerPtr              mGpuProfiler;
+
+  FrameStatisticsPtr mFrameStatistics;
+  uint64_t           mFrameStartTime{0};
+  uint64_t           mLastFrameStartTime{0};
+  uint64_t           mNextGpuFrameNumber{0};
+
+  // the fence of the frame which currently renders to the respective swap chain image; these are
+  // owned by mFrameResources
+  std::vector<vk::Fence> mImagesInFlight;
 
   VkSwapchainKHRPtr        mSwapChain;
+  std::vector<ImagePtr>    mOffscreenImages;
   VkRenderPassPtr          mRenderPass;
   std::vector<Framebuffer> mFramebuffers;
   uint32_t                 mImageCount;
@@ -11,21 +11,136 @@
 // ---------------------------------------------------------------------------------------- includes
 #include "Texture.hpp"
 
+#include "../Utils/File.hpp"
+#include "../Utils/Logger.hpp"
 #include "Device.hpp"
+#include "Instance.hpp"
+#include "PhysicalDevice.hpp"
+#include "UploadContext.hpp"
 
 #include <gli/gli.hpp>
 #include <stb_image.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+
 namespace Illusion {
 namespace Graphics {
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// the number of levels down to 1x1
+uint32_t getMipLevelCount(int32_t width, int32_t height) {
+  return static_cast<uint32_t>(std::floor(std::log2(std::max(1, std::max(width, height))))) + 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Reduces the image by a factor of two with a 2x2 box filter. For odd sizes the last column or
+// row is used twice.
+template <typename T>
+void downsample(
+  T const* src, int32_t srcWidth, int32_t srcHeight, T* dst, int32_t dstWidth, int32_t dstHeight,
+  uint32_t components) {
+
+  // integers are rounded to nearest
+  float offset{std::is_integral<T>::value ? 0.5f : 0.f};
+
+  for (int32_t y{0}; y < dstHeight; ++y) {
+    int32_t y0{std::min(2 * y, srcHeight - 1)};
+    int32_t y1{std::min(2 * y + 1, srcHeight - 1)};
+
+    for (int32_t x{0}; x < dstWidth; ++x) {
+      int32_t x0{std::min(2 * x, srcWidth - 1)};
+      int32_t x1{std::min(2 * x + 1, srcWidth - 1)};
+
+      for (uint32_t c{0}; c < components; ++c) {
+        float sum{static_cast<float>(src[(y0 * srcWidth + x0) * components + c]) +
+                  static_cast<float>(src[(y0 * srcWidth + x1) * components + c]) +
+                  static_cast<float>(src[(y1 * srcWidth + x0) * components + c]) +
+                  static_cast<float>(src[(y1 * srcWidth + x1) * components + c])};
+
+        dst[(y * dstWidth + x) * components + c] = static_cast<T>(sum * 0.25f + offset);
+      }
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Computes all levels down to 1x1 from the first one. The result contains all levels tightly
+// packed, levels is extended accordingly. Returns false if the format is not supported.
+template <typename T>
+bool generateMipmaps(
+  uint32_t                            components,
+  std::vector<Texture::TextureLevel>& levels,
+  void const*                         data,
+  std::vector<uint8_t>&               result) {
+
+  uint32_t count{getMipLevelCount(levels[0].mWidth, levels[0].mHeight)};
+
+  uint64_t size{0};
+  for (uint32_t i{0}; i < count; ++i) {
+    int32_t width{std::max(1, levels[0].mWidth >> i)};
+    int32_t height{std::max(1, levels[0].mHeight >> i)};
+    size += static_cast<uint64_t>(width) * height * components * sizeof(T);
+  }
+
+  result.resize(size);
+  std::memcpy(result.data(), data, levels[0].mSize);
+
+  uint64_t offset{levels[0].mSize};
+  levels.resize(1);
+
+  for (uint32_t i{1}; i < count; ++i) {
+    auto const& previous = levels.back();
+
+    Texture::TextureLevel level;
+    level.mWidth  = std::max(1, previous.mWidth / 2);
+    level.mHeight = std::max(1, previous.mHeight / 2);
+    level.mSize   = static_cast<uint64_t>(level.mWidth) * level.mHeight * components * sizeof(T);
+
+    downsample(
+      reinterpret_cast<T const*>(result.data() + offset - previous.mSize),
+      previous.mWidth,
+      previous.mHeight,
+      reinterpret_cast<T*>(result.data() + offset),
+      level.mWidth,
+      level.mHeight,
+      components);
+
+    offset += level.mSize;
+    levels.push_back(level);
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 Texture::Texture(
-  DevicePtr const& device, std::string const& fileName, vk::SamplerCreateInfo const& sampler) {
+  DevicePtr const&             device,
+  std::string const&           fileName,
+  vk::SamplerCreateInfo const& sampler,
+  bool                         generateMipmaps) {
+
+  // both loaders decode directly from the mapped file
+  MappedFilePtr file;
+  try {
+    file = File<uint8_t>(fileName).map();
+  } catch (std::runtime_error const& e) {
+    throw std::runtime_error{"Failed to load texture " + fileName + ": " + e.what()};
+  }
 
   // first try loading with gli
-  gli::texture texture = gli::load(fileName);
+  gli::texture texture = gli::load(reinterpret_cast<char const*>(file->getData()), file->getSize());
   if (!texture.empty()) {
     std::vector<TextureLevel> levels;
     for (uint32_t i{0}; i < texture.levels(); ++i) {
@@ -41,11 +156,14 @@ Texture::Texture(
   int   width, height, components, bytes;
   void* data;
 
-  if (stbi_is_hdr(fileName.c_str())) {
-    data  = stbi_loadf(fileName.c_str(), &width, &height, &components, 0);
+  auto fileData = reinterpret_cast<stbi_uc const*>(file->getData());
+  auto fileSize = static_cast<int>(file->getSize());
+
+  if (stbi_is_hdr_from_memory(fileData, fileSize)) {
+    data  = stbi_loadf_from_memory(fileData, fileSize, &width, &height, &components, 0);
     bytes = 4;
   } else {
-    data  = stbi_load(fileName.c_str(), &width, &height, &components, 0);
+    data  = stbi_load_from_memory(fileData, fileSize, &width, &height, &components, 0);
     bytes = 1;
   }
 
@@ -77,7 +195,7 @@ Texture::Texture(
         format = vk::Format::eR32G32B32A32Sfloat;
     }
 
-    InitData(device, levels, format, sampler, size, data);
+    InitData(device, levels, format, sampler, size, data, generateMipmaps);
 
     stbi_image_free(data);
 
@@ -98,14 +216,15 @@ Texture::Texture(
   vk::Format                   format,
   vk::SamplerCreateInfo const& sampler,
   size_t                       size,
-  void*                        data) {
+  void*                        data,
+  bool                         generateMipmaps) {
 
   TextureLevel level;
   level.mWidth  = width;
   level.mHeight = height;
   level.mSize   = size;
 
-  InitData(device, {level}, format, sampler, size, data);
+  InitData(device, {level}, format, sampler, size, data, generateMipmaps);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -123,27 +242,78 @@ Texture::Texture(
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+bool Texture::computeMipmaps(
+  vk::Format                 format,
+  std::vector<TextureLevel>& levels,
+  void const*                data,
+  std::vector<uint8_t>&      result) {
+
+  switch (format) {
+  case vk::Format::eR8Unorm:
+    return generateMipmaps<uint8_t>(1, levels, data, result);
+  case vk::Format::eR8G8Unorm:
+    return generateMipmaps<uint8_t>(2, levels, data, result);
+  case vk::Format::eR8G8B8Unorm:
+    return generateMipmaps<uint8_t>(3, levels, data, result);
+  case vk::Format::eR8G8B8A8Unorm:
+    return generateMipmaps<uint8_t>(4, levels, data, result);
+  case vk::Format::eR32Sfloat:
+    return generateMipmaps<float>(1, levels, data, result);
+  case vk::Format::eR32G32Sfloat:
+    return generateMipmaps<float>(2, levels, data, result);
+  case vk::Format::eR32G32B32Sfloat:
+    return generateMipmaps<float>(3, levels, data, result);
+  case vk::Format::eR32G32B32A32Sfloat:
+    return generateMipmaps<float>(4, levels, data, result);
+  default:
+    return false;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void Texture::InitData(
   DevicePtr const&             device,
   std::vector<TextureLevel>    levels,
   vk::Format                   format,
   vk::SamplerCreateInfo const& sampler,
   size_t                       size,
-  void*                        data) {
+  void*                        data,
+  bool                         generateMipmaps) {
 
-  auto stagingBuffer = device->createBuffer(
-    size,
-    vk::BufferUsageFlagBits::eTransferSrc,
-    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-    data);
+  uint32_t levelCount{static_cast<uint32_t>(levels.size())};
+  bool     blitMipmaps{false};
+
+  vk::ImageUsageFlags usage{vk::ImageUsageFlagBits::eSampled |
+                            vk::ImageUsageFlagBits::eTransferDst};
+
+  // holds all levels if they are generated on the CPU
+  std::vector<uint8_t> mipmaps;
+
+  if (generateMipmaps && levels.size() == 1 &&
+      getMipLevelCount(levels[0].mWidth, levels[0].mHeight) > 1) {
+
+    if (device->getInstance()->getPhysicalDevice()->supportsLinearBlit(format)) {
+      levelCount  = getMipLevelCount(levels[0].mWidth, levels[0].mHeight);
+      blitMipmaps = true;
+      usage |= vk::ImageUsageFlagBits::eTransferSrc;
+    } else if (computeMipmaps(format, levels, data, mipmaps)) {
+      levelCount = levels.size();
+      size       = mipmaps.size();
+      data       = mipmaps.data();
+    } else {
+      ILLUSION_WARNING << "Failed to generate mipmaps: Format " << vk::to_string(format)
+                       << " is not supported!" << std::endl;
+    }
+  }
 
   auto image = device->createImage(
     levels[0].mWidth,
     levels[0].mHeight,
-    levels.size(),
+    levelCount,
     format,
     vk::ImageTiling::eOptimal,
-    vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+    usage,
     vk::MemoryPropertyFlagBits::eDeviceLocal);
 
   mImage  = image->mImage;
@@ -156,7 +326,7 @@ void Texture::InitData(
     info.format                          = format;
     info.subresourceRange.aspectMask     = vk::ImageAspectFlagBits::eColor;
     info.subresourceRange.baseMipLevel   = 0;
-    info.subresourceRange.levelCount     = levels.size();
+    info.subresourceRange.levelCount     = levelCount;
     info.subresourceRange.baseArrayLayer = 0;
     info.subresourceRange.layerCount     = 1;
 
@@ -164,8 +334,10 @@ void Texture::InitData(
   }
 
   {
+    // the image view limits the levels already; not clamping maxLod to the level count lets
+    // textures of different sizes share their sampler through the SamplerCache
     vk::SamplerCreateInfo info(sampler);
-    info.maxLod = levels.size();
+    info.maxLod = VK_LOD_CLAMP_NONE;
 
     mSampler = device->createVkSampler(info);
   }
@@ -173,14 +345,9 @@ void Texture::InitData(
   vk::ImageSubresourceRange subresourceRange;
   subresourceRange.aspectMask   = vk::ImageAspectFlagBits::eColor;
   subresourceRange.baseMipLevel = 0;
-  subresourceRange.levelCount   = levels.size();
+  subresourceRange.levelCount   = levelCount;
   subresourceRange.layerCount   = 1;
 
-  device->transitionImageLayout(
-    mImage, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal, subresourceRange);
-
-  auto buffer = device->beginSingleTimeCommands();
-
   std::vector<vk::BufferImageCopy> infos;
   uint64_t                         offset = 0;
 
@@ -200,16 +367,16 @@ void Texture::InitData(
     offset += levels[i].mSize;
   }
 
-  buffer.copyBufferToImage(
-    *stagingBuffer->mBuffer, *mImage, vk::ImageLayout::eTransferDstOptimal, infos);
-
-  device->endSingleTimeCommands(buffer);
-
-  device->transitionImageLayout(
-    mImage,
-    vk::ImageLayout::eTransferDstOptimal,
+  // this is only recorded here, the upload is submitted together with all other pending uploads;
+  // if blitMipmaps is set, infos contains the first level only
+  mUploadTicket = device->getUploadContext()->uploadImage(
+    image,
+    subresourceRange,
+    infos,
+    size,
+    data,
     vk::ImageLayout::eShaderReadOnlyOptimal,
-    subresourceRange);
+    blitMipmaps);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
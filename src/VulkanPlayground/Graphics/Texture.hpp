@@ -13,6 +13,7 @@
 
 // ---------------------------------------------------------------------------------------- includes
 #include "../fwd.hpp"
+#include "UploadContext.hpp"
 
 namespace Illusion {
 namespace Graphics {
@@ -34,9 +35,18 @@ class Texture {
   };
 
   // --------------------------------------------------------------------------------------- methods
+  // Files which contain a single level only (everything but DDS and KTX) get a full mipmap chain
+  // if generateMipmaps is set. See the constructor below.
   Texture(
-    DevicePtr const& device, std::string const& fileName, vk::SamplerCreateInfo const& sampler);
+    DevicePtr const&             device,
+    std::string const&           fileName,
+    vk::SamplerCreateInfo const& sampler,
+    bool                         generateMipmaps = true);
 
+  // If generateMipmaps is set, the levels down to 1x1 are generated from the given data. This
+  // happens on the GPU with blits as part of the upload if the format supports this. Else the
+  // levels are computed on the CPU with a box filter, which is possible for 8 bit unorm and 32 bit
+  // float formats. For all other formats a warning is printed and the texture has a single level.
   Texture(
     DevicePtr const&             device,
     int32_t                      width,
@@ -44,7 +54,8 @@ class Texture {
     vk::Format                   format,
     vk::SamplerCreateInfo const& sampler,
     size_t                       size,
-    void*                        data);
+    void*                        data,
+    bool                         generateMipmaps = false);
 
   Texture(
     DevicePtr const&             device,
@@ -54,10 +65,23 @@ class Texture {
     size_t                       size,
     void*                        data);
 
-  VkImagePtr const&        getImage() const { return mImage; }
-  VkDeviceMemoryPtr const& getMemory() const { return mMemory; }
-  VkImageViewPtr const&    getImageView() const { return mImageView; }
-  VkSamplerPtr const&      getSampler() const { return mSampler; }
+  // Computes all levels down to 1x1 from the first one with a box filter. The result contains all
+  // levels tightly packed, levels is extended accordingly. This supports 8 bit unorm and 32 bit
+  // float formats with one to four components; false is returned for all other formats.
+  static bool computeMipmaps(
+    vk::Format                 format,
+    std::vector<TextureLevel>& levels,
+    void const*                data,
+    std::vector<uint8_t>&      result);
+
+  VkImagePtr const&          getImage() const { return mImage; }
+  MemoryAllocationPtr const& getMemory() const { return mMemory; }
+  VkImageViewPtr const&      getImageView() const { return mImageView; }
+  VkSamplerPtr const&        getSampler() const { return mSampler; }
+
+  // The image data is uploaded asynchronously; it is available to all command buffers submitted
+  // to the graphics queue after the next Device::flushUploads().
+  UploadTicket const& getUploadTicket() const { return mUploadTicket; }
 
   // ----------------------------------------------------------------------------- private interface
 
@@ -68,12 +92,14 @@ class Texture {
     vk::Format                   format,
     vk::SamplerCreateInfo const& sampler,
     size_t                       size,
-    void*                        data);
-
-  VkImagePtr        mImage;
-  VkDeviceMemoryPtr mMemory;
-  VkImageViewPtr    mImageView;
-  VkSamplerPtr      mSampler;
+    void*                        data,
+    bool                         generateMipmaps = false);
+
+  VkImagePtr          mImage;
+  MemoryAllocationPtr mMemory;
+  VkImageViewPtr      mImageView;
+  VkSamplerPtr        mSampler;
+  UploadTicket        mUploadTicket;
 };
 
 // -------------------------------------------------------------------------------------------------
@@ -0,0 +1,217 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "TextureCache.hpp"
+
+#include "../Utils/Hash.hpp"
+#include "../Utils/Logger.hpp"
+#include "SamplerCache.hpp"
+#include "Texture.hpp"
+
+#include <sys/stat.h>
+
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// seed of the second content hash; any value other than the default seed of hashBytes() will do
+const uint64_t CONTENT_CHECK_SEED{0x9e3779b97f4a7c15ull};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool TextureCache::Key::operator==(Key const& other) const {
+  return mFileName == other.mFileName && mModificationTime == other.mModificationTime &&
+         mSize == other.mSize && mContentHash == other.mContentHash &&
+         mContentCheck == other.mContentCheck && mWidth == other.mWidth &&
+         mHeight == other.mHeight && mFormat == other.mFormat && mSampler == other.mSampler &&
+         mGenerateMipmaps == other.mGenerateMipmaps;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureCache::TextureCache(DevicePtr const& device)
+  : mDevice(device) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TexturePtr TextureCache::get(
+  std::string const& fileName, vk::SamplerCreateInfo const& sampler, bool generateMipmaps) {
+
+  // files which cannot be accessed are not cached; the Texture will report the error
+  struct stat info;
+  if (stat(fileName.c_str(), &info) != 0) {
+    return std::make_shared<Texture>(mDevice, fileName, sampler, generateMipmaps);
+  }
+
+  Key key;
+  key.mFileName         = fileName;
+  key.mModificationTime = static_cast<int64_t>(info.st_mtime);
+  key.mSize             = static_cast<uint64_t>(info.st_size);
+  key.mSampler          = sampler;
+  key.mGenerateMipmaps  = generateMipmaps;
+
+  uint64_t hash{getHash(key)};
+
+  auto texture = find(hash, key);
+  if (texture) { return texture; }
+
+  ILLUSION_DEBUG << "Texture cache miss for \"" << fileName << "\"." << std::endl;
+
+  return insert(
+    hash, key, std::make_shared<Texture>(mDevice, fileName, sampler, generateMipmaps));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TexturePtr TextureCache::get(
+  int32_t                      width,
+  int32_t                      height,
+  vk::Format                   format,
+  vk::SamplerCreateInfo const& sampler,
+  size_t                       size,
+  void*                        data,
+  bool                         generateMipmaps) {
+
+  Key key;
+  key.mSize            = size;
+  key.mContentHash     = hashBytes(data, size);
+  key.mContentCheck    = hashBytes(data, size, CONTENT_CHECK_SEED);
+  key.mWidth           = width;
+  key.mHeight          = height;
+  key.mFormat          = format;
+  key.mSampler         = sampler;
+  key.mGenerateMipmaps = generateMipmaps;
+
+  uint64_t hash{getHash(key)};
+
+  auto texture = find(hash, key);
+  if (texture) { return texture; }
+
+  ILLUSION_DEBUG << "Texture cache miss for " << width << "x" << height << " image." << std::endl;
+
+  return insert(
+    hash,
+    key,
+    std::make_shared<Texture>(
+      mDevice, width, height, format, sampler, size, data, generateMipmaps));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureCache::Statistics TextureCache::getStatistics() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  Statistics statistics{mStatistics};
+  statistics.mTextureCount = 0;
+
+  for (auto const& entry : mEntries) {
+    if (!entry.second.mTexture.expired()) { ++statistics.mTextureCount; }
+  }
+
+  return statistics;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureCache::printStatistics() const {
+  auto     statistics = getStatistics();
+  uint32_t requests{statistics.mHits + statistics.mMisses};
+
+  ILLUSION_MESSAGE << "Texture cache: " << statistics.mHits << " hits, " << statistics.mMisses
+                   << " misses (" << (requests > 0 ? 100.0 * statistics.mHits / requests : 0.0)
+                   << "% hit rate), " << statistics.mTextureCount << " textures alive."
+                   << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t TextureCache::getHash(Key const& key) {
+  uint64_t samplerHash{SamplerCache::getHash(key.mSampler)};
+
+  uint64_t hash{hashBytes(key.mFileName.data(), key.mFileName.size())};
+  hash = hashBytes(&key.mModificationTime, sizeof(key.mModificationTime), hash);
+  hash = hashBytes(&key.mSize, sizeof(key.mSize), hash);
+  hash = hashBytes(&key.mContentHash, sizeof(key.mContentHash), hash);
+  hash = hashBytes(&key.mWidth, sizeof(key.mWidth), hash);
+  hash = hashBytes(&key.mHeight, sizeof(key.mHeight), hash);
+  hash = hashBytes(&key.mFormat, sizeof(key.mFormat), hash);
+  hash = hashBytes(&samplerHash, sizeof(samplerHash), hash);
+  hash = hashBytes(&key.mGenerateMipmaps, sizeof(key.mGenerateMipmaps), hash);
+
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TexturePtr TextureCache::find(uint64_t hash, Key const& key) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto it = mEntries.find(hash);
+
+  if (it != mEntries.end() && it->second.mKey == key) {
+    auto texture = it->second.mTexture.lock();
+
+    if (texture) {
+      ++mStatistics.mHits;
+      return texture;
+    }
+  }
+
+  ++mStatistics.mMisses;
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TexturePtr TextureCache::insert(uint64_t hash, Key const& key, TexturePtr const& texture) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto& entry    = mEntries[hash];
+  auto  existing = entry.mTexture.lock();
+
+  if (existing) {
+
+    // another thread may have created the same texture in the meantime
+    if (entry.mKey == key) { return existing; }
+
+    // on a hash collision, the texture which is already shared stays in the cache and the new one
+    // is not shared
+    ILLUSION_WARNING << "Texture cache hash collision, the texture will not be shared."
+                     << std::endl;
+    return texture;
+  }
+
+  entry.mKey     = key;
+  entry.mTexture = texture;
+
+  // remove the entries of textures which have been destroyed
+  for (auto it = mEntries.begin(); it != mEntries.end();) {
+    if (it->second.mTexture.expired()) {
+      it = mEntries.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  return texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_TEXTURE_CACHE_HPP
+#define ILLUSION_GRAPHICS_TEXTURE_CACHE_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../fwd.hpp"
+
+#include <mutex>
+#include <unordered_map>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shares Textures which are created from the same source. Files are identified by their path,    //
+// modification time and size, so a file which changes on disk is loaded again. Image data in     //
+// memory (for example embedded glTF images) is identified by a hash of its content. The sampler  //
+// and whether mipmaps are generated are part of the key as well. The entries hold weak           //
+// references only, so a Texture is destroyed once the last user has released it. Loading an      //
+// image which is still alive costs a hash lookup instead of a decode and an upload.              //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class TextureCache {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  struct Statistics {
+    uint32_t mHits{0};
+    uint32_t mMisses{0};
+
+    // textures which are currently alive
+    uint32_t mTextureCount{0};
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  TextureCache(DevicePtr const& device);
+
+  // These take the same arguments as the corresponding Texture constructors. Textures are created
+  // without holding the lock, so they can be called from multiple threads at once. If two threads
+  // create the same texture at the same time, the first one to finish is shared.
+  TexturePtr get(
+    std::string const&           fileName,
+    vk::SamplerCreateInfo const& sampler,
+    bool                         generateMipmaps = true);
+
+  TexturePtr get(
+    int32_t                      width,
+    int32_t                      height,
+    vk::Format                   format,
+    vk::SamplerCreateInfo const& sampler,
+    size_t                       size,
+    void*                        data,
+    bool                         generateMipmaps = false);
+
+  Statistics getStatistics() const;
+  void       printStatistics() const;
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  // Everything the hash is computed from, used to detect hash collisions. Files are identified by
+  // their name; for data in memory, the file name is empty and the content is compared through a
+  // second hash with another seed instead of keeping a copy of the data.
+  struct Key {
+    std::string           mFileName;
+    int64_t               mModificationTime{0};
+    uint64_t              mSize{0};
+    uint64_t              mContentHash{0};
+    uint64_t              mContentCheck{0};
+    int32_t               mWidth{0};
+    int32_t               mHeight{0};
+    vk::Format            mFormat{vk::Format::eUndefined};
+    vk::SamplerCreateInfo mSampler;
+    bool                  mGenerateMipmaps{false};
+
+    bool operator==(Key const& other) const;
+  };
+
+  struct Entry {
+    Key                    mKey;
+    std::weak_ptr<Texture> mTexture;
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  static uint64_t getHash(Key const& key);
+
+  TexturePtr find(uint64_t hash, Key const& key);
+  TexturePtr insert(uint64_t hash, Key const& key, TexturePtr const& texture);
+
+  // ------------------------------------------------------------------------------- private members
+  DevicePtr                           mDevice;
+  std::unordered_map<uint64_t, Entry> mEntries;
+
+  Statistics         mStatistics;
+  mutable std::mutex mMutex;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_TEXTURE_CACHE_HPP
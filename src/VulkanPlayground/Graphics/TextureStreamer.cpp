@@ -0,0 +1,354 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "TextureStreamer.hpp"
+
+#include "../Utils/AsyncFileReader.hpp"
+#include "../Utils/JobSystem.hpp"
+#include "../Utils/Logger.hpp"
+#include "../Utils/Profiler.hpp"
+#include "Device.hpp"
+#include "UploadContext.hpp"
+
+#include <gli/gli.hpp>
+#include <stb_image.h>
+
+#include <ostream>
+#include <queue>
+
+namespace Illusion {
+namespace Graphics {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double getMilliseconds(std::chrono::steady_clock::time_point const& start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+    .count();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StreamingTexture::StreamingTexture(
+  DevicePtr const&             device,
+  std::string const&           fileName,
+  vk::SamplerCreateInfo const& sampler,
+  TexturePtr const&            placeholder)
+  : mDevice(device)
+  , mFileName(fileName)
+  , mPlaceholder(placeholder)
+  , mCreationTime(std::chrono::steady_clock::now()) {
+
+  // the image view limits the levels, see Texture
+  vk::SamplerCreateInfo info(sampler);
+  info.maxLod = VK_LOD_CLAMP_NONE;
+
+  mSampler = device->createVkSampler(info);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VkImageViewPtr const& StreamingTexture::getImageView() const {
+  return mImageView ? mImageView : mPlaceholder->getImageView();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+double StreamingTexture::getDecodeMilliseconds() const {
+  return mIsDecoded ? mDecodeMilliseconds : -1.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StreamingTexture::decode() {
+  ILLUSION_PROFILE_ZONE("StreamingTexture::decode");
+
+  auto start = std::chrono::steady_clock::now();
+
+  try {
+    // rethrows read errors
+    auto file = mFileContent.get();
+
+    // files with mipmaps are uploaded as they are
+    gli::texture texture = gli::load(reinterpret_cast<char const*>(file.data()), file.size());
+
+    if (!texture.empty()) {
+      for (uint32_t i{0}; i < texture.levels(); ++i) {
+        mLevels.push_back({texture.extent(i).x, texture.extent(i).y, texture.size(i)});
+      }
+
+      auto data = static_cast<uint8_t const*>(texture.data());
+
+      mFormat = static_cast<vk::Format>(texture.format());
+      mData.assign(data, data + texture.size());
+
+    } else {
+
+      // all other files are expanded to four components, three-component formats are rarely
+      // supported for sampling
+      int   width, height, components;
+      void* data;
+
+      auto fileData = reinterpret_cast<stbi_uc const*>(file.data());
+      auto fileSize = static_cast<int>(file.size());
+
+      if (stbi_is_hdr_from_memory(fileData, fileSize)) {
+        data    = stbi_loadf_from_memory(fileData, fileSize, &width, &height, &components, 4);
+        mFormat = vk::Format::eR32G32B32A32Sfloat;
+      } else {
+        data    = stbi_load_from_memory(fileData, fileSize, &width, &height, &components, 4);
+        mFormat = vk::Format::eR8G8B8A8Unorm;
+      }
+
+      if (!data) { throw std::runtime_error{stbi_failure_reason()}; }
+
+      uint64_t bytes{mFormat == vk::Format::eR8G8B8A8Unorm ? 4u : 16u};
+      mLevels.push_back({width, height, static_cast<uint64_t>(width) * height * bytes});
+
+      Texture::computeMipmaps(mFormat, mLevels, data, mData);
+
+      stbi_image_free(data);
+    }
+
+  } catch (std::exception const& e) {
+    mError     = e.what();
+    mHasFailed = true;
+    return;
+  }
+
+  mDecodeMilliseconds = getMilliseconds(start);
+  mIsDecoded          = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vk::DeviceSize StreamingTexture::getNextLevelSize() const {
+  if (!mIsDecoded || (mImage && mResidentLevel == 0)) { return 0; }
+
+  // nothing has been uploaded yet, the smallest level is next
+  if (!mImage) { return mLevels.back().mSize; }
+
+  return mLevels[mResidentLevel - 1].mSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void StreamingTexture::upload(uint32_t level) {
+  ILLUSION_PROFILE_ZONE("StreamingTexture::upload");
+
+  uint32_t levelCount{static_cast<uint32_t>(mLevels.size())};
+
+  // the image is created once the size and format are known; all levels are allocated at once, but
+  // only the resident ones are covered by the image view
+  if (!mImage) {
+    mImage = mDevice->createImage(
+      mLevels[0].mWidth,
+      mLevels[0].mHeight,
+      levelCount,
+      mFormat,
+      vk::ImageTiling::eOptimal,
+      vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst,
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+    mResidentLevel = levelCount;
+  }
+
+  // the levels are stored from largest to smallest, so the uploaded ones are contiguous in mData
+  vk::DeviceSize offset{0};
+  for (uint32_t i{0}; i < level; ++i) {
+    offset += mLevels[i].mSize;
+  }
+
+  std::vector<vk::BufferImageCopy> regions;
+  vk::DeviceSize                   size{0};
+
+  for (uint32_t i{level}; i < mResidentLevel; ++i) {
+    vk::BufferImageCopy region;
+    region.imageSubresource.aspectMask     = vk::ImageAspectFlagBits::eColor;
+    region.imageSubresource.mipLevel       = i;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageExtent.width               = mLevels[i].mWidth;
+    region.imageExtent.height              = mLevels[i].mHeight;
+    region.imageExtent.depth               = 1;
+    region.bufferOffset                    = size;
+
+    regions.push_back(region);
+
+    size += mLevels[i].mSize;
+  }
+
+  // these levels are not part of the current image view, so they are not in use by any frame
+  vk::ImageSubresourceRange range;
+  range.aspectMask     = vk::ImageAspectFlagBits::eColor;
+  range.baseMipLevel   = level;
+  range.levelCount     = mResidentLevel - level;
+  range.baseArrayLayer = 0;
+  range.layerCount     = 1;
+
+  mDevice->getUploadContext()->uploadImage(mImage, range, regions, size, mData.data() + offset);
+
+  mResidentLevel = level;
+
+  // frames which are still in flight may use the previous view; it is kept until the texture is
+  // destroyed, there are only a few of them
+  if (mImageView) { mRetiredImageViews.push_back(mImageView); }
+
+  vk::ImageViewCreateInfo info;
+  info.image                       = *mImage->mImage;
+  info.viewType                    = vk::ImageViewType::e2D;
+  info.format                      = mFormat;
+  info.subresourceRange            = range;
+  info.subresourceRange.levelCount = levelCount - level;
+
+  mImageView = mDevice->createVkImageView(info);
+
+  // the staged data is not needed anymore
+  if (mResidentLevel == 0) {
+    mResidentMilliseconds = getMilliseconds(mCreationTime);
+    std::vector<uint8_t>().swap(mData);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+TextureStreamer::TextureStreamer(
+  DevicePtr const&                  device,
+  std::shared_ptr<JobSystem> const& jobSystem,
+  vk::DeviceSize                    bytesPerFrame)
+  : mDevice(device)
+  , mJobSystem(jobSystem)
+  , mFileReader(std::make_shared<AsyncFileReader>())
+  , mBytesPerFrame(bytesPerFrame) {
+
+  uint8_t gray[]{128, 128, 128, 255};
+  mPlaceholder = std::make_shared<Texture>(
+    device, 1, 1, vk::Format::eR8G8B8A8Unorm, vk::SamplerCreateInfo(), sizeof(gray), gray);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+StreamingTexturePtr TextureStreamer::load(
+  std::string const& fileName, vk::SamplerCreateInfo const& sampler) {
+
+  auto texture = std::make_shared<StreamingTexture>(mDevice, fileName, sampler, mPlaceholder);
+
+  // the read is issued right away, so the reads of all textures which are loaded in a row are in
+  // flight at the same time; update() enqueues the decoding once the file has been read, so no
+  // worker thread waits for I/O
+  texture->mFileContent = mFileReader->read(fileName);
+
+  mTextures.push_back(texture);
+
+  return texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void TextureStreamer::update() {
+  ILLUSION_PROFILE_ZONE("TextureStreamer::update");
+
+  auto start = std::chrono::steady_clock::now();
+
+  // the smallest pending level of all textures is uploaded first
+  typedef std::pair<vk::DeviceSize, size_t> Candidate;
+  std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+
+  std::vector<StreamingTexturePtr> textures;
+  std::vector<uint32_t>            levelCounts;
+  std::vector<uint32_t>            targetLevels;
+
+  for (auto const& weak : mTextures) {
+    auto texture = weak.lock();
+    if (!texture) { continue; }
+
+    if (texture->hasFailed()) {
+      ILLUSION_WARNING << "Failed to stream texture " << texture->getFileName() << ": "
+                       << texture->mError << std::endl;
+      continue;
+    }
+
+    if (
+      !texture->mIsDecodeEnqueued &&
+      texture->mFileContent.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+
+      // the texture may be released before it has been decoded
+      std::weak_ptr<StreamingTexture> weak{texture};
+      mJobSystem->enqueue([weak]() {
+        auto texture = weak.lock();
+        if (texture) { texture->decode(); }
+      });
+
+      texture->mIsDecodeEnqueued = true;
+    }
+
+    // the texture may be decoded on a worker thread meanwhile, so the level count is read once and
+    // a texture without levels yet is left alone for this frame
+    uint32_t levelCount{texture->getLevelCount()};
+
+    vk::DeviceSize size{levelCount > 0 ? texture->getNextLevelSize() : 0};
+    if (size > 0) { candidates.push(Candidate(size, textures.size())); }
+
+    levelCounts.push_back(levelCount);
+    targetLevels.push_back(texture->mImage ? texture->mResidentLevel : levelCount);
+    textures.push_back(texture);
+  }
+
+  vk::DeviceSize bytes{0};
+  uint64_t       levels{0};
+
+  while (!candidates.empty()) {
+    auto candidate = candidates.top();
+
+    // at least one level is uploaded per frame
+    if (bytes > 0 && bytes + candidate.first > mBytesPerFrame) { break; }
+
+    candidates.pop();
+    bytes += candidate.first;
+    ++levels;
+
+    auto const& texture = textures[candidate.second];
+    uint32_t&   level   = targetLevels[candidate.second];
+
+    if (--level > 0) {
+      candidates.push(Candidate(texture->mLevels[level - 1].mSize, candidate.second));
+    }
+  }
+
+  // textures which got new levels record one upload for all of them
+  mTextures.clear();
+
+  for (size_t i{0}; i < textures.size(); ++i) {
+    auto const& texture = textures[i];
+
+    if (
+      targetLevels[i] < levelCounts[i] &&
+      (!texture->mImage || targetLevels[i] < texture->mResidentLevel)) {
+      texture->upload(targetLevels[i]);
+    }
+
+    if (!texture->isResident()) { mTextures.push_back(texture); }
+  }
+
+  mStatistics.mPendingTextures = static_cast<uint32_t>(mTextures.size());
+  mStatistics.mUploadedBytes += bytes;
+  mStatistics.mUploadedLevels += levels;
+  mStatistics.mFrameBytes        = bytes;
+  mStatistics.mFrameMilliseconds = getMilliseconds(start);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
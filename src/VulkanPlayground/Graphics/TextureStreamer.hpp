@@ -0,0 +1,174 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_TEXTURE_STREAMER_HPP
+#define ILLUSION_GRAPHICS_TEXTURE_STREAMER_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../fwd.hpp"
+#include "Texture.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+
+namespace Illusion {
+
+class AsyncFileReader;
+class JobSystem;
+
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Loads textures without blocking the calling thread. TextureStreamer::load() returns a          //
+// StreamingTexture right away, which shows a small gray placeholder at first. The file is read   //
+// with an AsyncFileReader, so the reads of many textures are in flight at once. update() is      //
+// called once per frame; once it finds that a file has been read, the file is decoded on a       //
+// worker thread of the JobSystem, so no worker waits for I/O. Files without mipmaps get a full   //
+// chain computed with Texture::computeMipmaps() there as well. update() also uploads the levels  //
+// which are not resident yet, smallest first, until the per-frame byte budget is used up. The    //
+// smallest levels of all textures are uploaded before any texture gets its larger ones. Whenever //
+// levels have been uploaded, the StreamingTexture gets a new image view which starts at the most //
+// detailed resident level; descriptor sets using the texture have to be updated when             //
+// getResidentLevel() changes.                                                                    //
+// The uploads are recorded to the UploadContext and submitted by the next Device::flushUploads() //
+// (the Surface does this in endFrame()), that is before the frame which uses the new view.       //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class StreamingTexture {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  // Use TextureStreamer::load() to create StreamingTextures.
+  StreamingTexture(
+    DevicePtr const&             device,
+    std::string const&           fileName,
+    vk::SamplerCreateInfo const& sampler,
+    TexturePtr const&            placeholder);
+
+  // Returns the view of the placeholder until the first levels are resident.
+  VkImageViewPtr const& getImageView() const;
+  VkSamplerPtr const&   getSampler() const { return mSampler; }
+
+  // The most detailed level which is resident. This is getLevelCount() as long as no level is
+  // resident and 0 once the texture has been streamed completely.
+  uint32_t getResidentLevel() const { return mResidentLevel; }
+  uint32_t getLevelCount() const { return mIsDecoded ? static_cast<uint32_t>(mLevels.size()) : 0; }
+  bool     isResident() const { return mImage && mResidentLevel == 0; }
+
+  // If decoding failed, the texture shows the placeholder forever.
+  bool               hasFailed() const { return mHasFailed; }
+  std::string const& getFileName() const { return mFileName; }
+
+  // Milliseconds spent in decoding the file, without reading it, and milliseconds from construction
+  // until all levels have been uploaded respectively; negative if this has not happened yet.
+  double getDecodeMilliseconds() const;
+  double getResidentMilliseconds() const { return mResidentMilliseconds; }
+
+ private:
+  // ------------------------------------------------------------------------------- private methods
+  friend class TextureStreamer;
+
+  // runs on a worker thread once mFileContent is ready
+  void decode();
+
+  // size of the next level to upload, 0 if there is none or the texture is not decoded yet
+  vk::DeviceSize getNextLevelSize() const;
+
+  // records the upload of all levels from the given one up to the resident ones
+  void upload(uint32_t level);
+
+  // ------------------------------------------------------------------------------- private members
+  DevicePtr   mDevice;
+  std::string mFileName;
+  TexturePtr  mPlaceholder;
+
+  ImagePtr                    mImage;
+  VkImageViewPtr              mImageView;
+  VkSamplerPtr                mSampler;
+  std::vector<VkImageViewPtr> mRetiredImageViews;
+
+  // set by TextureStreamer::load(), consumed by decode(); TextureStreamer::update() polls it and
+  // enqueues decode() once it is ready
+  std::future<std::vector<uint8_t>> mFileContent;
+  bool                              mIsDecodeEnqueued{false};
+
+  uint32_t mResidentLevel{0};
+
+  // written by decode(), these may only be accessed once mIsDecoded is set
+  vk::Format                         mFormat{vk::Format::eUndefined};
+  std::vector<Texture::TextureLevel> mLevels;
+  std::vector<uint8_t>               mData;
+  std::string                        mError;
+  double                             mDecodeMilliseconds{-1.0};
+
+  std::atomic<bool> mIsDecoded{false};
+  std::atomic<bool> mHasFailed{false};
+
+  std::chrono::steady_clock::time_point mCreationTime;
+  double                                mResidentMilliseconds{-1.0};
+};
+
+// -------------------------------------------------------------------------------------------------
+class TextureStreamer {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  struct Statistics {
+    // textures which are decoded or uploaded at the moment
+    uint32_t mPendingTextures{0};
+
+    uint64_t mUploadedBytes{0};
+    uint64_t mUploadedLevels{0};
+
+    // bytes uploaded and CPU time spent by the last call to update()
+    uint64_t mFrameBytes{0};
+    double   mFrameMilliseconds{0.0};
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  // At least one level is uploaded per frame, even if it exceeds the budget.
+  TextureStreamer(
+    DevicePtr const&                  device,
+    std::shared_ptr<JobSystem> const& jobSystem,
+    vk::DeviceSize                    bytesPerFrame = 4 * 1024 * 1024);
+
+  // This and update() have to be called from the same thread.
+  StreamingTexturePtr load(std::string const& fileName, vk::SamplerCreateInfo const& sampler);
+
+  // Records the uploads of this frame. Call this once per frame before Surface::endFrame().
+  void update();
+
+  // Returns true if no texture is decoded or uploaded at the moment.
+  bool isIdle() const { return mTextures.empty(); }
+
+  void           setBytesPerFrame(vk::DeviceSize bytes) { mBytesPerFrame = bytes; }
+  vk::DeviceSize getBytesPerFrame() const { return mBytesPerFrame; }
+
+  Statistics const& getStatistics() const { return mStatistics; }
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  DevicePtr                        mDevice;
+  std::shared_ptr<JobSystem>       mJobSystem;
+  std::shared_ptr<AsyncFileReader> mFileReader;
+  vk::DeviceSize                   mBytesPerFrame;
+  TexturePtr                       mPlaceholder;
+
+  // the textures which are not resident yet
+  std::vector<std::weak_ptr<StreamingTexture>> mTextures;
+
+  Statistics mStatistics;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_TEXTURE_STREAMER_HPP
@@ -16,6 +16,7 @@
 #include "../Utils/Logger.hpp"
 #include "Device.hpp"
 #include "Texture.hpp"
+#include "TextureCache.hpp"
 
 namespace Illusion {
 namespace Graphics {
@@ -70,7 +71,10 @@ vk::SamplerAddressMode convertSamplerAddressMode(int value) {
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 TexturePtr createTexture(
-  DevicePtr const& device, tinygltf::Sampler const& sampler, tinygltf::Image const& image) {
+  DevicePtr const&         device,
+  tinygltf::Sampler const& sampler,
+  tinygltf::Image const&   image,
+  TextureCachePtr const&   cache) {
 
   vk::SamplerCreateInfo info;
   info.magFilter               = convertFilter(sampler.magFilter);
@@ -87,22 +91,32 @@ TexturePtr createTexture(
   info.mipmapMode              = convertSamplerMipmapMode(sampler.minFilter);
   info.mipLodBias              = 0.0f;
   info.minLod                  = 0.0f;
-  info.maxLod                  = 0;
+  info.maxLod                  = VK_LOD_CLAMP_NONE;
 
   // if no image data has been loaded, try loading it on out own
-  if (image.image.empty()) { return std::make_shared<Texture>(device, image.uri, info); }
+  if (image.image.empty()) {
+    if (cache) { return cache->get(image.uri, info); }
+    return std::make_shared<Texture>(device, image.uri, info);
+  }
 
   // if there is image data, create an appropriate texture object for it
-  uint32_t channels = image.image.size() / image.width / image.height;
+  uint32_t   channels = image.image.size() / image.width / image.height;
+  vk::Format format{channels == 3 ? vk::Format::eR8G8B8Unorm : vk::Format::eR8G8B8A8Unorm};
+
+  if (cache) {
+    return cache->get(
+      image.width, image.height, format, info, image.image.size(), (void*)image.image.data(), true);
+  }
 
   return std::make_shared<Texture>(
     device,
     image.width,
     image.height,
-    channels == 3 ? vk::Format::eR8G8B8Unorm : vk::Format::eR8G8B8A8Unorm,
+    format,
     info,
     image.image.size(),
-    (void*)image.image.data());
+    (void*)image.image.data(),
+    true);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -22,8 +22,12 @@ namespace TinyGLTF {
 
 // -------------------------------------------------------------------------------------------------
 
+// If a cache is given, textures which are created from the same image and sampler are shared.
 TexturePtr createTexture(
-  DevicePtr const& device, tinygltf::Sampler const& sampler, tinygltf::Image const& image);
+  DevicePtr const&         device,
+  tinygltf::Sampler const& sampler,
+  tinygltf::Image const&   image,
+  TextureCachePtr const&   cache = nullptr);
 
 // -------------------------------------------------------------------------------------------------
 }
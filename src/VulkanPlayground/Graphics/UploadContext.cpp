@@ -0,0 +1,487 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "UploadContext.hpp"
+
+#include "../Utils/Logger.hpp"
+#include "../Utils/Profiler.hpp"
+#include "Device.hpp"
+#include "ResourceStateTracker.hpp"
+#include "StagingRing.hpp"
+#include "VulkanPtr.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+VkCommandPoolPtr createCommandPool(VkDevicePtr const& device, uint32_t queueFamily) {
+  vk::CommandPoolCreateInfo info;
+  info.queueFamilyIndex = queueFamily;
+  info.flags            = vk::CommandPoolCreateFlagBits::eTransient;
+
+  ILLUSION_DEBUG << "Creating command pool." << std::endl;
+  return makeVulkanPtr(device, device->createCommandPool(info));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+vk::CommandBuffer beginCommandBuffer(VkDevicePtr const& device, VkCommandPoolPtr const& pool) {
+  vk::CommandBufferAllocateInfo info;
+  info.level              = vk::CommandBufferLevel::ePrimary;
+  info.commandPool        = *pool;
+  info.commandBufferCount = 1;
+
+  vk::CommandBuffer commandBuffer{device->allocateCommandBuffers(info)[0]};
+
+  vk::CommandBufferBeginInfo beginInfo;
+  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+  commandBuffer.begin(beginInfo);
+
+  return commandBuffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Each level is blitted to the next one. All levels are in eTransferDstOptimal layout when this is
+// called and the range contains at least two levels.
+void recordMipmapChain(
+  vk::CommandBuffer const& commandBuffer, UploadTicket::Batch::MipmapChain const& chain) {
+
+  uint32_t lastLevel{chain.mRange.baseMipLevel + chain.mRange.levelCount - 1};
+
+  // the first level has been written by the copy of the upload
+  ResourceStateTracker tracker;
+  tracker.addImage(
+    chain.mImage,
+    lastLevel + 1,
+    chain.mRange.baseArrayLayer + chain.mRange.layerCount,
+    chain.mRange.aspectMask,
+    vk::ImageLayout::eTransferDstOptimal,
+    vk::AccessFlagBits::eTransferWrite,
+    vk::PipelineStageFlagBits::eTransfer);
+
+  vk::ImageSubresourceRange range{chain.mRange};
+  range.levelCount = 1;
+
+  int32_t width{static_cast<int32_t>(chain.mExtent.width)};
+  int32_t height{static_cast<int32_t>(chain.mExtent.height)};
+
+  for (uint32_t level{chain.mRange.baseMipLevel}; level < lastLevel; ++level) {
+    range.baseMipLevel = level;
+    tracker.useImage(
+      chain.mImage,
+      range,
+      vk::ImageLayout::eTransferSrcOptimal,
+      vk::AccessFlagBits::eTransferRead,
+      vk::PipelineStageFlagBits::eTransfer);
+
+    range.baseMipLevel = level + 1;
+    tracker.useImage(
+      chain.mImage,
+      range,
+      vk::ImageLayout::eTransferDstOptimal,
+      vk::AccessFlagBits::eTransferWrite,
+      vk::PipelineStageFlagBits::eTransfer);
+
+    tracker.flush(commandBuffer);
+
+    vk::ImageBlit blit;
+    blit.srcSubresource.aspectMask     = chain.mRange.aspectMask;
+    blit.srcSubresource.mipLevel       = level;
+    blit.srcSubresource.baseArrayLayer = chain.mRange.baseArrayLayer;
+    blit.srcSubresource.layerCount     = chain.mRange.layerCount;
+    blit.srcOffsets[1]                 = vk::Offset3D(width, height, 1);
+
+    width  = std::max(1, width / 2);
+    height = std::max(1, height / 2);
+
+    blit.dstSubresource          = blit.srcSubresource;
+    blit.dstSubresource.mipLevel = level + 1;
+    blit.dstOffsets[1]           = vk::Offset3D(width, height, 1);
+
+    commandBuffer.blitImage(
+      chain.mImage,
+      vk::ImageLayout::eTransferSrcOptimal,
+      chain.mImage,
+      vk::ImageLayout::eTransferDstOptimal,
+      blit,
+      vk::Filter::eLinear);
+  }
+
+  // the image may be used by any stage afterwards
+  tracker.useImage(
+    chain.mImage,
+    chain.mRange,
+    chain.mFinalLayout,
+    vk::AccessFlagBits::eShaderRead,
+    vk::PipelineStageFlagBits::eAllCommands);
+
+  tracker.flush(commandBuffer);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadTicket::UploadTicket(UploadContextPtr const& context, std::shared_ptr<Batch> const& batch)
+  : mContext(context)
+  , mBatch(batch) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool UploadTicket::isReady() const {
+  if (!mBatch) { return true; }
+
+  {
+    std::lock_guard<std::mutex> lock(mContext->mMutex);
+    if (!mBatch->mSubmitted) { return false; }
+  }
+
+  return mContext->mDevice->getFenceStatus(*mBatch->mFence) == vk::Result::eSuccess;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UploadTicket::wait() const {
+  if (!mBatch) { return; }
+
+  // batches are only unsubmitted while they are recorded
+  {
+    std::lock_guard<std::mutex> lock(mContext->mMutex);
+    if (!mBatch->mSubmitted) { mContext->submitOpenBatch(); }
+  }
+
+  mContext->mDevice->waitForFences(*mBatch->mFence, true, ~0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadContext::UploadContext(
+  VkDevicePtr const&    device,
+  StagingRingPtr const& stagingRing,
+  vk::Queue const&      transferQueue,
+  uint32_t              transferFamily,
+  vk::Queue const&      graphicsQueue,
+  uint32_t              graphicsFamily,
+  std::mutex&           queueMutex)
+  : mDevice(device)
+  , mStagingRing(stagingRing)
+  , mTransferQueue(transferQueue)
+  , mGraphicsQueue(graphicsQueue)
+  , mTransferFamily(transferFamily)
+  , mGraphicsFamily(graphicsFamily)
+  , mQueueMutex(queueMutex)
+  , mTransferCommandPool(createCommandPool(device, transferFamily)) {
+
+  if (mTransferFamily != mGraphicsFamily) {
+    mGraphicsCommandPool = createCommandPool(device, graphicsFamily);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadContext::~UploadContext() {
+  if (mOpenBatch) {
+    mDevice->freeCommandBuffers(*mTransferCommandPool, mOpenBatch->mCommandBuffer);
+  }
+
+  for (auto const& batch : mPendingBatches) {
+    mDevice->waitForFences(*batch->mFence, true, ~0);
+    mDevice->freeCommandBuffers(*mTransferCommandPool, batch->mCommandBuffer);
+
+    if (mGraphicsCommandPool) {
+      mDevice->freeCommandBuffers(*mGraphicsCommandPool, batch->mAcquireCommandBuffer);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadTicket UploadContext::uploadBuffer(
+  BufferPtr const& buffer, vk::DeviceSize size, void const* data, vk::DeviceSize offset) {
+
+  ILLUSION_PROFILE_ZONE("UploadContext::uploadBuffer");
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // the staged regions of the open batch can only be reused once it has been submitted
+  if (mStagingRing->isBlockedByOpenRegions(size)) { submitOpenBatch(); }
+
+  auto const& batch = getOpenBatch();
+
+  auto staging = mStagingRing->allocate(size);
+  std::memcpy(staging.mData, data, size);
+
+  vk::BufferCopy copy;
+  copy.srcOffset = staging.mOffset;
+  copy.dstOffset = offset;
+  copy.size      = size;
+
+  batch->mCommandBuffer.copyBuffer(*staging.mBuffer->mBuffer, *buffer->mBuffer, copy);
+
+  vk::BufferMemoryBarrier barrier;
+  barrier.srcAccessMask       = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask       = vk::AccessFlagBits::eMemoryRead;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer              = *buffer->mBuffer;
+  barrier.offset              = offset;
+  barrier.size                = size;
+
+  batch->mBufferBarriers.push_back(barrier);
+  batch->mResources.push_back(buffer);
+
+  ++mUploadCount;
+
+  return UploadTicket(shared_from_this(), batch);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadTicket UploadContext::uploadImage(
+  ImagePtr const&                         image,
+  vk::ImageSubresourceRange const&        range,
+  std::vector<vk::BufferImageCopy> const& regions,
+  vk::DeviceSize                          size,
+  void const*                             data,
+  vk::ImageLayout                         finalLayout,
+  bool                                    generateMipmaps) {
+
+  ILLUSION_PROFILE_ZONE("UploadContext::uploadImage");
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  // The region offset has to be a multiple of 4 and of the texel (or block) size of the format.
+  // 48 satisfies this for all formats including three-component ones.
+  vk::DeviceSize alignment{48};
+
+  // the staged regions of the open batch can only be reused once it has been submitted
+  if (mStagingRing->isBlockedByOpenRegions(size, alignment)) { submitOpenBatch(); }
+
+  auto const& batch = getOpenBatch();
+
+  auto staging = mStagingRing->allocate(size, alignment);
+  std::memcpy(staging.mData, data, size);
+
+  // the previous content is discarded, so no ownership transfer is required here
+  vk::ImageMemoryBarrier barrier;
+  barrier.oldLayout           = vk::ImageLayout::eUndefined;
+  barrier.newLayout           = vk::ImageLayout::eTransferDstOptimal;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image               = *image->mImage;
+  barrier.subresourceRange    = range;
+  barrier.dstAccessMask       = vk::AccessFlagBits::eTransferWrite;
+
+  batch->mCommandBuffer.pipelineBarrier(
+    vk::PipelineStageFlagBits::eTopOfPipe,
+    vk::PipelineStageFlagBits::eTransfer,
+    vk::DependencyFlagBits(),
+    nullptr,
+    nullptr,
+    barrier);
+
+  std::vector<vk::BufferImageCopy> copies(regions);
+  for (auto& copy : copies) {
+    copy.bufferOffset += staging.mOffset;
+  }
+
+  batch->mCommandBuffer.copyBufferToImage(
+    *staging.mBuffer->mBuffer, *image->mImage, vk::ImageLayout::eTransferDstOptimal, copies);
+
+  barrier.oldLayout     = vk::ImageLayout::eTransferDstOptimal;
+  barrier.newLayout     = finalLayout;
+  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+  // the image stays in eTransferDstOptimal layout until the levels have been generated
+  if (generateMipmaps && range.levelCount > 1 && !regions.empty()) {
+    barrier.newLayout     = vk::ImageLayout::eTransferDstOptimal;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eTransferWrite;
+
+    batch->mMipmapChains.push_back({*image->mImage, regions[0].imageExtent, range, finalLayout});
+  }
+
+  batch->mImageBarriers.push_back(barrier);
+  batch->mResources.push_back(image);
+
+  ++mUploadCount;
+
+  return UploadTicket(shared_from_this(), batch);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadTicket UploadContext::submit() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return submitOpenBatch();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+UploadTicket UploadContext::submitOpenBatch() {
+  ILLUSION_PROFILE_ZONE("UploadContext::submit");
+
+  releaseFinishedBatches();
+
+  if (!mOpenBatch) { return UploadTicket(); }
+
+  auto batch = mOpenBatch;
+  mOpenBatch.reset();
+
+  ILLUSION_DEBUG << "Creating fence." << std::endl;
+  batch->mFence = makeVulkanPtr(mDevice, mDevice->createFence(vk::FenceCreateInfo()));
+
+  if (mTransferFamily == mGraphicsFamily) {
+
+    // make the uploads visible to all subsequent commands on the queue
+    batch->mCommandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eAllCommands,
+      vk::DependencyFlagBits(),
+      nullptr,
+      batch->mBufferBarriers,
+      batch->mImageBarriers);
+
+    for (auto const& chain : batch->mMipmapChains) {
+      recordMipmapChain(batch->mCommandBuffer, chain);
+    }
+
+    batch->mCommandBuffer.end();
+
+    vk::SubmitInfo info;
+    info.commandBufferCount = 1;
+    info.pCommandBuffers    = &batch->mCommandBuffer;
+
+    // this may be called from any thread, the frames are submitted to the same queues
+    std::lock_guard<std::mutex> queueLock(mQueueMutex);
+    mTransferQueue.submit(info, *batch->mFence);
+
+  } else {
+
+    // The release barriers are recorded on the transfer queue, the matching acquire barriers on
+    // the graphics queue. Both have to specify the same layouts and queue families; the access
+    // masks of the respective other side are ignored.
+    for (auto& barrier : batch->mBufferBarriers) {
+      barrier.srcQueueFamilyIndex = mTransferFamily;
+      barrier.dstQueueFamilyIndex = mGraphicsFamily;
+    }
+
+    for (auto& barrier : batch->mImageBarriers) {
+      barrier.srcQueueFamilyIndex = mTransferFamily;
+      barrier.dstQueueFamilyIndex = mGraphicsFamily;
+    }
+
+    batch->mCommandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      vk::PipelineStageFlagBits::eBottomOfPipe,
+      vk::DependencyFlagBits(),
+      nullptr,
+      batch->mBufferBarriers,
+      batch->mImageBarriers);
+
+    batch->mCommandBuffer.end();
+
+    batch->mAcquireCommandBuffer = beginCommandBuffer(mDevice, mGraphicsCommandPool);
+
+    batch->mAcquireCommandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTopOfPipe,
+      vk::PipelineStageFlagBits::eAllCommands,
+      vk::DependencyFlagBits(),
+      nullptr,
+      batch->mBufferBarriers,
+      batch->mImageBarriers);
+
+    // the transfer queue may not support blits
+    for (auto const& chain : batch->mMipmapChains) {
+      recordMipmapChain(batch->mAcquireCommandBuffer, chain);
+    }
+
+    batch->mAcquireCommandBuffer.end();
+
+    ILLUSION_DEBUG << "Creating semaphore." << std::endl;
+    batch->mSemaphore =
+      VkSemaphoreHandle(mDevice, mDevice->createSemaphore(vk::SemaphoreCreateInfo()));
+
+    vk::SubmitInfo releaseInfo;
+    releaseInfo.commandBufferCount   = 1;
+    releaseInfo.pCommandBuffers      = &batch->mCommandBuffer;
+    releaseInfo.signalSemaphoreCount = 1;
+    releaseInfo.pSignalSemaphores    = &batch->mSemaphore.get();
+
+    std::lock_guard<std::mutex> queueLock(mQueueMutex);
+    mTransferQueue.submit(releaseInfo, nullptr);
+
+    // the fence is signaled once the acquire has been executed, which implies that the transfer
+    // has finished as well
+    vk::PipelineStageFlags waitStage{vk::PipelineStageFlagBits::eAllCommands};
+
+    vk::SubmitInfo acquireInfo;
+    acquireInfo.waitSemaphoreCount = 1;
+    acquireInfo.pWaitSemaphores    = &batch->mSemaphore.get();
+    acquireInfo.pWaitDstStageMask  = &waitStage;
+    acquireInfo.commandBufferCount = 1;
+    acquireInfo.pCommandBuffers    = &batch->mAcquireCommandBuffer;
+
+    mGraphicsQueue.submit(acquireInfo, *batch->mFence);
+  }
+
+  batch->mSubmitted = true;
+  mStagingRing->retire(batch->mFence);
+  mPendingBatches.push_back(batch);
+
+  ++mSubmissionCount;
+
+  return UploadTicket(shared_from_this(), batch);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::shared_ptr<UploadTicket::Batch> const& UploadContext::getOpenBatch() {
+  if (!mOpenBatch) {
+    mOpenBatch                 = std::make_shared<UploadTicket::Batch>();
+    mOpenBatch->mCommandBuffer = beginCommandBuffer(mDevice, mTransferCommandPool);
+  }
+
+  return mOpenBatch;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void UploadContext::releaseFinishedBatches() {
+  while (!mPendingBatches.empty() &&
+         mDevice->getFenceStatus(*mPendingBatches.front()->mFence) == vk::Result::eSuccess) {
+
+    auto const& batch = mPendingBatches.front();
+    mDevice->freeCommandBuffers(*mTransferCommandPool, batch->mCommandBuffer);
+
+    if (mGraphicsCommandPool) {
+      mDevice->freeCommandBuffers(*mGraphicsCommandPool, batch->mAcquireCommandBuffer);
+    }
+
+    batch->mResources.clear();
+
+    mPendingBatches.pop_front();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+}
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_UPLOAD_CONTEXT_HPP
+#define ILLUSION_GRAPHICS_UPLOAD_CONTEXT_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../fwd.hpp"
+#include "VulkanHandle.hpp"
+
+#include <deque>
+#include <mutex>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// The UploadContext records buffer and image uploads together with the required layout           //
+// transitions into one command buffer. Everything recorded since the last submit() is sent to    //
+// the transfer queue in a single submission with one fence. The data is staged through the       //
+// StagingRing of the Device; the staged regions are retired with the fence of the submission.    //
+// If the transfer queue belongs to another family than the graphics queue, ownership of all      //
+// uploaded resources is released on the transfer queue and acquired on the graphics queue with   //
+// a small second submission which waits on a semaphore.                                          //
+// Each upload returns an UploadTicket which can be polled or waited on. Usually the Surface      //
+// submits once per frame; the open batch is submitted early if an UploadTicket of it is waited   //
+// on or if its staged regions fill up the StagingRing.                                           //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class UploadTicket {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  // all uploads of one submission share the same batch
+  struct Batch {
+    vk::CommandBuffer mCommandBuffer;
+    VkFencePtr        mFence;
+    bool              mSubmitted{false};
+
+    // only used if there is a dedicated transfer family
+    vk::CommandBuffer mAcquireCommandBuffer;
+    VkSemaphoreHandle mSemaphore;
+
+    // these make the uploads available to the graphics queue; they are recorded in submit()
+    std::vector<vk::BufferMemoryBarrier> mBufferBarriers;
+    std::vector<vk::ImageMemoryBarrier>  mImageBarriers;
+
+    // images whose levels are generated from their first level after the upload; blits require a
+    // graphics queue, therefore they are recorded in submit() after the barriers above
+    struct MipmapChain {
+      vk::Image                 mImage;
+      vk::Extent3D              mExtent;
+      vk::ImageSubresourceRange mRange;
+      vk::ImageLayout           mFinalLayout;
+    };
+
+    std::vector<MipmapChain> mMipmapChains;
+
+    // kept alive until the batch has been executed
+    std::vector<std::shared_ptr<void>> mResources;
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  // A default constructed ticket is always ready.
+  UploadTicket() = default;
+  UploadTicket(UploadContextPtr const& context, std::shared_ptr<Batch> const& batch);
+
+  // Returns true once the upload has been executed by the device.
+  bool isReady() const;
+
+  // Blocks until the upload has been executed. If its batch is still being recorded, it is
+  // submitted right away.
+  void wait() const;
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  UploadContextPtr       mContext;
+  std::shared_ptr<Batch> mBatch;
+};
+
+// -------------------------------------------------------------------------------------------------
+class UploadContext : public std::enable_shared_from_this<UploadContext> {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  // The transfer queue may be the graphics queue. All submissions to the queues are done while
+  // holding the given mutex, see Device::getQueueMutex().
+  UploadContext(
+    VkDevicePtr const&    device,
+    StagingRingPtr const& stagingRing,
+    vk::Queue const&      transferQueue,
+    uint32_t              transferFamily,
+    vk::Queue const&      graphicsQueue,
+    uint32_t              graphicsFamily,
+    std::mutex&           queueMutex);
+  virtual ~UploadContext();
+
+  // Copies size bytes of data to the given offset of the buffer. The buffer has to be created with
+  // eTransferDst usage.
+  UploadTicket uploadBuffer(
+    BufferPtr const& buffer, vk::DeviceSize size, void const* data, vk::DeviceSize offset = 0);
+
+  // Copies data to the image. The bufferOffsets of the given regions are relative to data. The
+  // image is transitioned from eUndefined to eTransferDstOptimal before the copy and to the given
+  // layout afterwards.
+  // If generateMipmaps is set, the regions have to cover the first level of the range only. All
+  // other levels of the range are then generated on the graphics queue by successively blitting
+  // each level to the next with linear filtering, in the same submission as the upload. The image
+  // needs eTransferSrc usage and its format has to support linear blits, see
+  // PhysicalDevice::supportsLinearBlit().
+  UploadTicket uploadImage(
+    ImagePtr const&                         image,
+    vk::ImageSubresourceRange const&        range,
+    std::vector<vk::BufferImageCopy> const& regions,
+    vk::DeviceSize                          size,
+    void const*                             data,
+    vk::ImageLayout finalLayout     = vk::ImageLayout::eShaderReadOnlyOptimal,
+    bool            generateMipmaps = false);
+
+  // Submits everything recorded since the last call. The Surface does this in endFrame(), but it
+  // may be called from any thread.
+  UploadTicket submit();
+
+  // Number of submissions and uploads since construction.
+  uint64_t getSubmissionCount() const { return mSubmissionCount; }
+  uint64_t getUploadCount() const { return mUploadCount; }
+
+ private:
+  // ------------------------------------------------------------------------------- private methods
+  friend class UploadTicket;
+
+  // returns the batch which is currently recorded, beginning a new one if necessary
+  std::shared_ptr<UploadTicket::Batch> const& getOpenBatch();
+
+  // the implementation of submit(), mMutex has to be locked
+  UploadTicket submitOpenBatch();
+
+  // frees the command buffers and resources of finished batches
+  void releaseFinishedBatches();
+
+  // ------------------------------------------------------------------------------- private members
+  VkDevicePtr      mDevice;
+  StagingRingPtr   mStagingRing;
+  vk::Queue        mTransferQueue, mGraphicsQueue;
+  uint32_t         mTransferFamily, mGraphicsFamily;
+  std::mutex&      mQueueMutex;
+  VkCommandPoolPtr mTransferCommandPool, mGraphicsCommandPool;
+
+  std::shared_ptr<UploadTicket::Batch>             mOpenBatch;
+  std::deque<std::shared_ptr<UploadTicket::Batch>> mPendingBatches;
+
+  uint64_t mSubmissionCount{0};
+  uint64_t mUploadCount{0};
+
+  std::mutex mMutex;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_UPLOAD_CONTEXT_HPP
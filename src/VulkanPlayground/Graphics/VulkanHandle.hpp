@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_GRAPHICS_VULKAN_HANDLE_HPP
+#define ILLUSION_GRAPHICS_VULKAN_HANDLE_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "../Utils/Logger.hpp"
+#include "../fwd.hpp"
+
+#include <iostream>
+
+namespace Illusion {
+namespace Graphics {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A VulkanHandle owns one object which has been created by a vk::Device and destroys it together //
+// with itself. It cannot be copied, only moved, so passing it around never touches a reference   //
+// count. The function which destroys the object is chosen at compile time by the VulkanDeleter   //
+// specialization of its type. The handle keeps the device alive until the object is destroyed.   //
+// Use share() if the object really needs several owners; the result is one of the Vk*Ptr types   //
+// of fwd.hpp.                                                                                    //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+template <typename T>
+struct VulkanDeleter;
+
+#define ILLUSION_DECLARE_VULKAN_DELETER(TYPE_NAME, NAME, FUNCTION)                                 \
+  template <>                                                                                      \
+  struct VulkanDeleter<vk::TYPE_NAME> {                                                            \
+    static const char* getName() { return NAME; }                                                  \
+    static void destroy(vk::Device const& device, vk::TYPE_NAME const& object) {                   \
+      device.FUNCTION(object);                                                                     \
+    }                                                                                              \
+  };
+
+ILLUSION_DECLARE_VULKAN_DELETER(Buffer, "buffer", destroyBuffer)
+ILLUSION_DECLARE_VULKAN_DELETER(CommandPool, "command pool", destroyCommandPool)
+ILLUSION_DECLARE_VULKAN_DELETER(DescriptorPool, "descriptor pool", destroyDescriptorPool)
+ILLUSION_DECLARE_VULKAN_DELETER(
+  DescriptorSetLayout, "descriptor set layout", destroyDescriptorSetLayout)
+ILLUSION_DECLARE_VULKAN_DELETER(DeviceMemory, "memory", freeMemory)
+ILLUSION_DECLARE_VULKAN_DELETER(Fence, "fence", destroyFence)
+ILLUSION_DECLARE_VULKAN_DELETER(Framebuffer, "framebuffer", destroyFramebuffer)
+ILLUSION_DECLARE_VULKAN_DELETER(Image, "image", destroyImage)
+ILLUSION_DECLARE_VULKAN_DELETER(ImageView, "image view", destroyImageView)
+ILLUSION_DECLARE_VULKAN_DELETER(Pipeline, "pipeline", destroyPipeline)
+ILLUSION_DECLARE_VULKAN_DELETER(PipelineLayout, "pipeline layout", destroyPipelineLayout)
+ILLUSION_DECLARE_VULKAN_DELETER(QueryPool, "query pool", destroyQueryPool)
+ILLUSION_DECLARE_VULKAN_DELETER(RenderPass, "render pass", destroyRenderPass)
+ILLUSION_DECLARE_VULKAN_DELETER(Sampler, "sampler", destroySampler)
+ILLUSION_DECLARE_VULKAN_DELETER(Semaphore, "semaphore", destroySemaphore)
+ILLUSION_DECLARE_VULKAN_DELETER(ShaderModule, "shader module", destroyShaderModule)
+ILLUSION_DECLARE_VULKAN_DELETER(SwapchainKHR, "swap chain", destroySwapchainKHR)
+
+#undef ILLUSION_DECLARE_VULKAN_DELETER
+
+// -------------------------------------------------------------------------------------------------
+template <typename T>
+class VulkanHandle {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  VulkanHandle() = default;
+
+  // The object has to be created by the given device.
+  VulkanHandle(VkDevicePtr const& device, T const& object)
+    : mDevice(device)
+    , mObject(object) {}
+
+  VulkanHandle(VulkanHandle&& other) noexcept
+    : mDevice(std::move(other.mDevice))
+    , mObject(other.mObject) {
+    other.mObject = T();
+  }
+
+  VulkanHandle& operator=(VulkanHandle&& other) noexcept {
+    if (this != &other) {
+      reset();
+      mDevice       = std::move(other.mDevice);
+      mObject       = other.mObject;
+      other.mObject = T();
+    }
+    return *this;
+  }
+
+  VulkanHandle(VulkanHandle const& other) = delete;
+  VulkanHandle& operator=(VulkanHandle const& other) = delete;
+
+  ~VulkanHandle() { reset(); }
+
+  // Destroys the object; the handle is empty afterwards.
+  void reset() {
+    if (mObject) {
+      ILLUSION_DEBUG << "Deleting " << VulkanDeleter<T>::getName() << "." << std::endl;
+      VulkanDeleter<T>::destroy(*mDevice, mObject);
+      mObject = T();
+    }
+    mDevice.reset();
+  }
+
+  // Moves the object to a std::shared_ptr. The handle and the reference count share one
+  // allocation. This handle is empty afterwards.
+  std::shared_ptr<T> share() {
+    auto shared = std::make_shared<VulkanHandle>(std::move(*this));
+    return std::shared_ptr<T>(shared, &shared->mObject);
+  }
+
+  T const& get() const { return mObject; }
+  T const& operator*() const { return mObject; }
+  T const* operator->() const { return &mObject; }
+
+  explicit operator bool() const { return static_cast<bool>(mObject); }
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  VkDevicePtr mDevice;
+  T           mObject;
+};
+}
+}
+
+#endif // ILLUSION_GRAPHICS_VULKAN_HANDLE_HPP
@@ -12,6 +12,8 @@
 #define ILLUSION_GRAPHICS_VULKAN_PTR_HPP
 
 // ---------------------------------------------------------------------------------------- includes
+#include "VulkanHandle.hpp"
+
 #include <functional>
 #include <memory>
 
@@ -23,11 +25,20 @@ struct Identity {
   typedef T type;
 };
 
+// For objects which are not created by a vk::Device, like the instance or the device itself. The
+// deleter is stored in a std::function.
 template <typename T>
 static std::shared_ptr<T>
 makeVulkanPtr(T const& vkObject, typename Identity<std::function<void(T* obj)>>::type deleter) {
   return std::shared_ptr<T>(new T{vkObject}, deleter);
 }
+
+// For objects created by a vk::Device; they are destroyed by their VulkanDeleter. This needs only
+// one allocation for the object and the reference count and no std::function.
+template <typename T>
+std::shared_ptr<T> makeVulkanPtr(VkDevicePtr const& device, T const& vkObject) {
+  return VulkanHandle<T>(device, vkObject).share();
+}
 }
 }
 
@@ -36,7 +36,7 @@ Window::~Window() {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void Window::open(bool fullscreen) {
+void Window::open(bool fullscreen, uint32_t framesInFlight) {
   if (!mWindow) {
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -49,7 +49,7 @@ void Window::open(bool fullscreen) {
       mWindow = glfwCreateWindow(800, 600, "VulkanPlayground", nullptr, nullptr);
     }
 
-    mSurface = std::make_shared<Surface>(mDevice, mWindow);
+    mSurface = std::make_shared<Surface>(mDevice, mWindow, framesInFlight);
 
     glfwSetWindowUserPointer(mWindow, this);
 
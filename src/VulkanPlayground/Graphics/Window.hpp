@@ -34,7 +34,7 @@ class Window {
   Window(DevicePtr const& device);
   ~Window();
 
-  void open(bool fullscreen);
+  void open(bool fullscreen, uint32_t framesInFlight = 2);
   void close();
   bool shouldClose() const;
   void processInput();
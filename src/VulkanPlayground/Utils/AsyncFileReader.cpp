@@ -0,0 +1,582 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "AsyncFileReader.hpp"
+
+#include "JobSystem.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ILLUSION_HAS_IO_URING
+#endif
+#endif
+#endif
+
+namespace Illusion {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// how often io_uring_enter() is retried in a row if the kernel is temporarily out of resources;
+// for submissions this applies only if no read is in flight
+const uint32_t MAX_ENTER_RETRIES{100};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::runtime_error makeError(std::string const& fileName, int error) {
+  return std::runtime_error{"Failed to read file \"" + fileName + "\": " + std::strerror(error)};
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// this is used by the thread pool backend
+std::vector<uint8_t> readFile(std::string const& fileName) {
+#if defined(_WIN32)
+  std::ifstream stream(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!stream) { throw std::runtime_error{"Failed to read file \"" + fileName + "\"!"}; }
+
+  std::vector<uint8_t> data(static_cast<size_t>(stream.tellg()));
+  stream.seekg(0, std::ios::beg);
+
+  if (!stream.read(reinterpret_cast<char*>(data.data()), data.size())) {
+    throw std::runtime_error{"Failed to read file \"" + fileName + "\"!"};
+  }
+
+  return data;
+#else
+  int file{open(fileName.c_str(), O_RDONLY | O_CLOEXEC)};
+  if (file < 0) { throw makeError(fileName, errno); }
+
+  struct stat info;
+  if (fstat(file, &info) != 0) {
+    int error{errno};
+    close(file);
+    throw makeError(fileName, error);
+  }
+
+  std::vector<uint8_t> data(static_cast<size_t>(info.st_size));
+  size_t               offset{0};
+
+  while (offset < data.size()) {
+    ssize_t result{pread(file, data.data() + offset, data.size() - offset, offset)};
+
+    if (result < 0 && errno == EINTR) { continue; }
+
+    if (result <= 0) {
+      int error{result < 0 ? errno : EIO};
+      close(file);
+      throw makeError(fileName, error);
+    }
+
+    offset += static_cast<size_t>(result);
+  }
+
+  close(file);
+
+  return data;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+#if defined(ILLUSION_HAS_IO_URING)
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A minimal io_uring wrapper which only issues vectored reads. The rings are accessed directly,  //
+// so liburing is not required.                                                                   //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class AsyncFileReader::IoUring {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  struct Request {
+    std::string                       mFileName;
+    int                               mFile{-1};
+    std::vector<uint8_t>              mData;
+    size_t                            mOffset{0};
+    iovec                             mVector;
+    std::promise<std::vector<uint8_t>> mPromise;
+  };
+
+  // -------------------------------------------------------------------------------- public methods
+  // Throws a std::runtime_error if io_uring is not supported.
+  IoUring(uint32_t queueDepth) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(io_uring_params));
+
+    mRing = static_cast<int>(syscall(__NR_io_uring_setup, queueDepth, &params));
+    if (mRing < 0) {
+      throw std::runtime_error{std::string("io_uring_setup failed: ") + std::strerror(errno)};
+    }
+
+    mSubmissionSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    mCompletionSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    // since Linux 5.4 both rings share one mapping; older kernel headers neither know the feature
+    // flag nor the features field, the rings are mapped separately then
+#if defined(IORING_FEAT_SINGLE_MMAP)
+    bool singleMapping{(params.features & IORING_FEAT_SINGLE_MMAP) != 0};
+#else
+    bool singleMapping{false};
+#endif
+
+    if (singleMapping) {
+      mSubmissionSize = mCompletionSize = std::max(mSubmissionSize, mCompletionSize);
+    }
+
+    mSubmissionRing = map(mSubmissionSize, IORING_OFF_SQ_RING);
+    mCompletionRing = singleMapping ? mSubmissionRing : map(mCompletionSize, IORING_OFF_CQ_RING);
+    mEntries = static_cast<io_uring_sqe*>(
+      map(params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES));
+    mEntryCount = params.sq_entries;
+
+    auto sq{static_cast<uint8_t*>(mSubmissionRing)};
+    mSqTail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    mSqMask  = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    mSqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    auto cq{static_cast<uint8_t*>(mCompletionRing)};
+    mCqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    mCqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    mCqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    mCqes   = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    mThread = std::thread(&IoUring::completionLoop, this);
+  }
+
+  ~IoUring() {
+    // the completion thread finishes the reads in flight and quits
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+
+    mCondition.notify_one();
+    mThread.join();
+
+    munmap(mEntries, mEntryCount * sizeof(io_uring_sqe));
+    if (mCompletionRing != mSubmissionRing) { munmap(mCompletionRing, mCompletionSize); }
+    munmap(mSubmissionRing, mSubmissionSize);
+    close(mRing);
+  }
+
+  // Takes ownership of the requests. Returns false without doing so if the ring has been
+  // abandoned, see isBroken().
+  bool submit(std::vector<Request*> const& requests) {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mBroken) { return false; }
+
+    for (auto request : requests) {
+      mWaiting.push_back(request);
+    }
+
+    submitWaiting();
+    mCondition.notify_one();
+
+    return true;
+  }
+
+  // Returns true once waiting for completions has failed permanently. All requests which were
+  // pending at this point have failed and no further requests are accepted.
+  bool isBroken() const { return mBroken; }
+
+ private:
+  // ------------------------------------------------------------------------------- private methods
+  void* map(size_t size, off_t offset) {
+    void* result{mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing,
+                      offset)};
+    if (result == MAP_FAILED) {
+      throw std::runtime_error{std::string("Failed to map io_uring: ") + std::strerror(errno)};
+    }
+    return result;
+  }
+
+  int enter(unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(
+      syscall(__NR_io_uring_enter, mRing, toSubmit, minComplete, flags, nullptr, 0));
+  }
+
+  // Writes a read of the remaining part of the request to the submission ring. mMutex has to be
+  // locked.
+  void pushEntry(Request* request) {
+    unsigned tail{*mSqTail};
+    unsigned index{tail & mSqMask};
+
+    io_uring_sqe& entry = mEntries[index];
+    std::memset(&entry, 0, sizeof(io_uring_sqe));
+
+    request->mVector.iov_base = request->mData.data() + request->mOffset;
+    request->mVector.iov_len  = request->mData.size() - request->mOffset;
+
+    entry.opcode    = IORING_OP_READV;
+    entry.fd        = request->mFile;
+    entry.off       = request->mOffset;
+    entry.addr      = reinterpret_cast<uint64_t>(&request->mVector);
+    entry.len       = 1;
+    entry.user_data = reinterpret_cast<uint64_t>(request);
+
+    mSqArray[index] = index;
+    __atomic_store_n(mSqTail, tail + 1, __ATOMIC_RELEASE);
+  }
+
+  // Submits the last count entries of the submission ring and returns how many of them have been
+  // consumed by the kernel. The others are removed from the ring again, which is possible as the
+  // kernel reads the ring during io_uring_enter() only. If not all of them have been consumed,
+  // error is set to the errno of io_uring_enter() or to EAGAIN. mMutex has to be locked.
+  unsigned submitEntries(unsigned count, int& error) {
+    int result;
+
+    do {
+      result = enter(count, 0, 0);
+    } while (result < 0 && errno == EINTR);
+
+    error = result < 0 ? errno : EAGAIN;
+
+    unsigned submitted{result < 0 ? 0u : static_cast<unsigned>(result)};
+
+    if (submitted < count) {
+      __atomic_store_n(mSqTail, *mSqTail - (count - submitted), __ATOMIC_RELEASE);
+    }
+
+    return submitted;
+  }
+
+  // Fulfills the promise of the request with an error and deletes it.
+  void fail(Request* request, int error) {
+    request->mPromise.set_exception(std::make_exception_ptr(makeError(request->mFileName, error)));
+    close(request->mFile);
+    delete request;
+  }
+
+  // Fails all pending requests and stops accepting new ones. The kernel may still write to the
+  // buffers of the reads in flight, so these requests are never deleted. mMutex has to be locked.
+  void abandon(int error) {
+    ILLUSION_ERROR << "io_uring_enter failed: " << std::strerror(error)
+                   << ". Falling back to pread()." << std::endl;
+
+    for (auto request : mInFlight) {
+      request->mPromise.set_exception(
+        std::make_exception_ptr(makeError(request->mFileName, error)));
+    }
+
+    for (auto request : mWaiting) {
+      fail(request, error);
+    }
+
+    mInFlight.clear();
+    mWaiting.clear();
+    mBroken = true;
+  }
+
+  // Moves as many waiting requests to the kernel as the queue depth allows. If the kernel is
+  // temporarily out of resources, the rejected requests are retried once another read completes,
+  // or right away if nothing is in flight. On other errors, all waiting requests fail. Hence
+  // nothing is waiting once this returns with no reads in flight. mMutex has to be locked.
+  void submitWaiting() {
+    uint32_t retries{0};
+
+    while (!mWaiting.empty() && mInFlight.size() < mEntryCount) {
+      std::vector<Request*> pushed;
+
+      while (!mWaiting.empty() && mInFlight.size() + pushed.size() < mEntryCount) {
+        pushEntry(mWaiting.front());
+        pushed.push_back(mWaiting.front());
+        mWaiting.pop_front();
+      }
+
+      int      error;
+      unsigned submitted{submitEntries(static_cast<unsigned>(pushed.size()), error)};
+
+      mInFlight.insert(pushed.begin(), pushed.begin() + submitted);
+
+      if (submitted == pushed.size()) { continue; }
+
+      mWaiting.insert(mWaiting.begin(), pushed.begin() + submitted, pushed.end());
+
+      bool temporary{error == EAGAIN || error == EBUSY};
+
+      if (temporary && !mInFlight.empty()) { return; }
+
+      if (temporary && ++retries < MAX_ENTER_RETRIES) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      ILLUSION_ERROR << "io_uring_enter failed: " << std::strerror(error) << std::endl;
+
+      for (auto request : mWaiting) {
+        fail(request, error);
+      }
+
+      mWaiting.clear();
+    }
+  }
+
+  void completionLoop() {
+    uint32_t retries{0};
+
+    while (true) {
+
+      // waiting for completions is only possible if there are reads in flight, else this would
+      // block forever
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this]() { return !mInFlight.empty() || mStop; });
+
+        // nothing is waiting either, see submitWaiting()
+        if (mInFlight.empty()) { return; }
+      }
+
+      int error{enter(0, 1, IORING_ENTER_GETEVENTS) < 0 ? errno : 0};
+
+      // temporary errors are retried a few times, all others would most likely occur again
+      if (error != 0 && error != EINTR) {
+        bool temporary{error == EAGAIN || error == EBUSY};
+
+        if (!temporary || ++retries >= MAX_ENTER_RETRIES) {
+          std::lock_guard<std::mutex> lock(mMutex);
+          abandon(error);
+          return;
+        }
+
+        std::this_thread::yield();
+      } else {
+        retries = 0;
+      }
+
+      std::vector<Request*> unfinished;
+      std::vector<Request*> completed;
+
+      unsigned head{*mCqHead};
+      unsigned tail{__atomic_load_n(mCqTail, __ATOMIC_ACQUIRE)};
+
+      for (; head != tail; ++head) {
+        io_uring_cqe const& completion = mCqes[head & mCqMask];
+        auto request = reinterpret_cast<Request*>(completion.user_data);
+
+        // the request may be deleted below, only the pointer is used afterwards
+        completed.push_back(request);
+
+        if (completion.res < 0 || (completion.res == 0 && request->mData.size() > 0)) {
+          fail(request, completion.res < 0 ? -completion.res : EIO);
+          continue;
+        }
+
+        request->mOffset += static_cast<size_t>(completion.res);
+
+        // reads may be short, the remaining part is read with another request
+        if (request->mOffset < request->mData.size()) {
+          unfinished.push_back(request);
+          continue;
+        }
+
+        request->mPromise.set_value(std::move(request->mData));
+        close(request->mFile);
+        delete request;
+      }
+
+      __atomic_store_n(mCqHead, head, __ATOMIC_RELEASE);
+
+      std::lock_guard<std::mutex> lock(mMutex);
+
+      for (auto request : completed) {
+        mInFlight.erase(request);
+      }
+
+      mWaiting.insert(mWaiting.begin(), unfinished.begin(), unfinished.end());
+      submitWaiting();
+    }
+  }
+
+  // ------------------------------------------------------------------------------- private members
+  int           mRing{-1};
+  void*         mSubmissionRing{nullptr};
+  void*         mCompletionRing{nullptr};
+  size_t        mSubmissionSize{0};
+  size_t        mCompletionSize{0};
+  io_uring_sqe* mEntries{nullptr};
+  unsigned      mEntryCount{0};
+
+  unsigned*     mSqTail{nullptr};
+  unsigned      mSqMask{0};
+  unsigned*     mSqArray{nullptr};
+  unsigned*     mCqHead{nullptr};
+  unsigned*     mCqTail{nullptr};
+  unsigned      mCqMask{0};
+  io_uring_cqe* mCqes{nullptr};
+
+  // the completion thread sleeps on this while there are no reads in flight
+  std::condition_variable mCondition;
+
+  std::mutex                   mMutex;
+  std::deque<Request*>         mWaiting;
+  std::unordered_set<Request*> mInFlight;
+  std::atomic<bool>            mBroken{false};
+  bool                         mStop{false};
+  std::thread                  mThread;
+};
+
+#else
+
+// -------------------------------------------------------------------------------------------------
+class AsyncFileReader::IoUring {};
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncFileReader::AsyncFileReader(uint32_t queueDepth, bool allowIoUring)
+  : mQueueDepth(std::max(1u, queueDepth)) {
+
+#if defined(ILLUSION_HAS_IO_URING)
+  if (allowIoUring) {
+    try {
+      mIoUring.reset(new IoUring(mQueueDepth));
+      ILLUSION_DEBUG << "Creating asynchronous file reader using io_uring." << std::endl;
+      return;
+    } catch (std::runtime_error const& e) {
+      ILLUSION_DEBUG << "Cannot use io_uring: " << e.what() << std::endl;
+    }
+  }
+#endif
+
+  getJobSystem();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncFileReader::~AsyncFileReader() { ILLUSION_DEBUG << "Deleting file reader." << std::endl; }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AsyncFileReader::Backend AsyncFileReader::getBackend() const {
+#if defined(ILLUSION_HAS_IO_URING)
+  if (mIoUring && !mIoUring->isBroken()) { return Backend::eIoUring; }
+#endif
+
+  return Backend::eThreadPool;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::future<std::vector<uint8_t>> AsyncFileReader::read(std::string const& fileName) {
+  return std::move(read(std::vector<std::string>{fileName}).front());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::future<std::vector<uint8_t>>> AsyncFileReader::read(
+  std::vector<std::string> const& fileNames) {
+
+  std::vector<std::future<std::vector<uint8_t>>> results;
+
+#if defined(ILLUSION_HAS_IO_URING)
+  if (mIoUring && !mIoUring->isBroken()) {
+    std::vector<IoUring::Request*> requests;
+
+    for (auto const& fileName : fileNames) {
+      std::unique_ptr<IoUring::Request> request{new IoUring::Request()};
+      request->mFileName = fileName;
+      results.push_back(request->mPromise.get_future());
+
+      // opening and stat'ing is cheap compared to the actual read, so this is done right here
+      request->mFile = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+
+      struct stat info;
+      if (request->mFile < 0 || fstat(request->mFile, &info) != 0) {
+        request->mPromise.set_exception(std::make_exception_ptr(makeError(fileName, errno)));
+        if (request->mFile >= 0) { close(request->mFile); }
+        continue;
+      }
+
+      // empty files are not sent to the kernel at all
+      if (info.st_size == 0) {
+        request->mPromise.set_value(std::vector<uint8_t>());
+        close(request->mFile);
+        continue;
+      }
+
+      request->mData.resize(static_cast<size_t>(info.st_size));
+      requests.push_back(request.release());
+    }
+
+    if (mIoUring->submit(requests)) { return results; }
+
+    // the ring has been abandoned in the meantime, the futures have been handed out already
+    for (auto request : requests) {
+      std::shared_ptr<IoUring::Request> owner{request};
+      close(owner->mFile);
+
+      getJobSystem().enqueue([owner]() {
+        try {
+          owner->mPromise.set_value(readFile(owner->mFileName));
+        } catch (...) { owner->mPromise.set_exception(std::current_exception()); }
+      });
+    }
+
+    return results;
+  }
+#endif
+
+  for (auto const& fileName : fileNames) {
+    results.push_back(getJobSystem().enqueue([fileName]() { return readFile(fileName); }));
+  }
+
+  return results;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+JobSystem& AsyncFileReader::getJobSystem() {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (!mJobSystem) {
+    uint32_t cores{std::max(1u, std::thread::hardware_concurrency())};
+    mJobSystem.reset(new JobSystem(std::min(mQueueDepth, cores * 4)));
+
+    ILLUSION_DEBUG << "Creating asynchronous file reader using " << mJobSystem->getThreadCount()
+                   << " threads." << std::endl;
+  }
+
+  return *mJobSystem;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_UTILS_ASYNC_FILE_READER_HPP
+#define ILLUSION_UTILS_ASYNC_FILE_READER_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Illusion {
+
+class JobSystem;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reads entire files in the background. A batch of files is submitted at once and each file is   //
+// delivered through a future; errors are rethrown by future::get(). On Linux, the reads are      //
+// issued with io_uring, keeping up to queueDepth reads in flight; further requests wait until    //
+// earlier ones complete. A single thread reaps the completions. Where io_uring is not available  //
+// (old kernels, seccomp filters, other platforms), the files are read with pread() on the        //
+// worker threads of a JobSystem instead. If waiting for io_uring completions fails permanently,  //
+// the reads in flight fail and all further reads use the JobSystem as well.                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class AsyncFileReader {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  enum class Backend { eIoUring, eThreadPool };
+
+  // -------------------------------------------------------------------------------- public methods
+  // If allowIoUring is false, the thread pool is used in any case. The thread pool uses queueDepth
+  // threads, but not more than four per core.
+  explicit AsyncFileReader(uint32_t queueDepth = 64, bool allowIoUring = true);
+
+  // Waits for all pending reads.
+  virtual ~AsyncFileReader();
+
+  std::future<std::vector<uint8_t>> read(std::string const& fileName);
+
+  // All files are submitted to the kernel with a single system call.
+  std::vector<std::future<std::vector<uint8_t>>> read(std::vector<std::string> const& fileNames);
+
+  Backend getBackend() const;
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  class IoUring;
+
+  // ------------------------------------------------------------------------------- private methods
+  // creates the thread pool on first use
+  JobSystem& getJobSystem();
+
+  // ------------------------------------------------------------------------------- private members
+  uint32_t                   mQueueDepth;
+  std::unique_ptr<IoUring>   mIoUring;
+  std::unique_ptr<JobSystem> mJobSystem;
+  std::mutex                 mMutex;
+};
+}
+
+#endif // ILLUSION_UTILS_ASYNC_FILE_READER_HPP
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// ---------------------------------------------------------------------------------------- includes
+#include "CacheFile.hpp"
+
+#include "File.hpp"
+#include "Hash.hpp"
+#include "Logger.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace Illusion {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// this precedes the actual data in the file
+struct FileHeader {
+  uint32_t mMagic;
+  uint32_t mVersion;
+  uint64_t mDataSize;
+  uint64_t mDataHash;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// std::rename() fails on Windows if the target exists already
+bool replaceFile(std::string const& from, std::string const& to) {
+#if defined(_WIN32)
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+CacheFile::CacheFile(
+  std::string const& fileName,
+  uint32_t           magic,
+  uint32_t           version,
+  std::string const& description)
+  : mFileName(fileName)
+  , mMagic(magic)
+  , mVersion(version)
+  , mDescription(description) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint8_t> CacheFile::load() const {
+  if (mFileName.empty()) { return {}; }
+
+  File<uint8_t> file(mFileName);
+
+  if (!file.isValid()) {
+    ILLUSION_DEBUG << "No " << mDescription << " \"" << mFileName << "\" found." << std::endl;
+    return {};
+  }
+
+  auto const& content = file.getContent();
+
+  FileHeader header;
+  if (content.size() < sizeof(FileHeader)) {
+    ILLUSION_WARNING << "Discarding " << mDescription << " \"" << mFileName
+                     << "\": File is truncated." << std::endl;
+    return {};
+  }
+
+  std::memcpy(&header, content.data(), sizeof(FileHeader));
+
+  if (header.mMagic != mMagic || header.mVersion != mVersion) {
+    ILLUSION_WARNING << "Discarding " << mDescription << " \"" << mFileName
+                     << "\": Unknown file format." << std::endl;
+    return {};
+  }
+
+  std::vector<uint8_t> data(content.begin() + sizeof(FileHeader), content.end());
+
+  if (header.mDataSize != data.size() || header.mDataHash != hashBytes(data.data(), data.size())) {
+    ILLUSION_WARNING << "Discarding " << mDescription << " \"" << mFileName
+                     << "\": File is corrupt." << std::endl;
+    return {};
+  }
+
+  return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool CacheFile::save(std::vector<uint8_t> const& data) const {
+  if (mFileName.empty()) { return false; }
+
+  FileHeader header;
+  header.mMagic    = mMagic;
+  header.mVersion  = mVersion;
+  header.mDataSize = data.size();
+  header.mDataHash = hashBytes(data.data(), data.size());
+
+  std::vector<uint8_t> content(sizeof(FileHeader) + data.size());
+  std::memcpy(content.data(), &header, sizeof(FileHeader));
+  std::memcpy(content.data() + sizeof(FileHeader), data.data(), data.size());
+
+  File<uint8_t> file(mFileName + ".tmp");
+  file.setContent(content);
+
+  if (!file.save() || !replaceFile(mFileName + ".tmp", mFileName)) {
+    ILLUSION_WARNING << "Failed to save " << mDescription << " \"" << mFileName << "\"!"
+                     << std::endl;
+    return false;
+  }
+
+  ILLUSION_DEBUG << "Saved " << mDescription << " \"" << mFileName << "\" (" << data.size()
+                 << " bytes)." << std::endl;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef ILLUSION_UTILS_CACHE_FILE_HPP
+#define ILLUSION_UTILS_CACHE_FILE_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Illusion {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// The on-disk format of the PipelineCache and the ShaderReflectionCache. The data is preceded by //
+// a small header with a magic number, a version and the size and a hash of the data, so          //
+// truncated or corrupt files are detected and discarded. Files are written to a temporary file   //
+// first which is then moved over the old one, so a crash while saving does not leave a corrupt   //
+// file behind.                                                                                   //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class CacheFile {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  // The description is used in log messages only, e.g. "pipeline cache". If fileName is empty,
+  // nothing is loaded or saved.
+  CacheFile(
+    std::string const& fileName,
+    uint32_t           magic,
+    uint32_t           version,
+    std::string const& description);
+
+  // Returns an empty vector if the file does not exist or cannot be used.
+  std::vector<uint8_t> load() const;
+
+  // Returns false if the file could not be written.
+  bool save(std::vector<uint8_t> const& data) const;
+
+  std::string const& getFileName() const { return mFileName; }
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  std::string mFileName;
+  uint32_t    mMagic;
+  uint32_t    mVersion;
+  std::string mDescription;
+};
+}
+
+#endif // ILLUSION_UTILS_CACHE_FILE_HPP
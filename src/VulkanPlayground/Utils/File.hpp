@@ -13,6 +13,7 @@
 
 // ---------------------------------------------------------------------------------------- includes
 #include "../Utils/Logger.hpp"
+#include "MappedFile.hpp"
 
 #include <fstream>
 #include <sstream>
@@ -75,6 +76,13 @@ class File {
     return mContent;
   }
 
+  // Maps the file into memory instead of reading it into a vector, see MappedFile. Throws a
+  // std::runtime_error if the file cannot be opened.
+  MappedFilePtr map(
+    MappedFile::AccessPattern pattern = MappedFile::AccessPattern::eSequential) const {
+    return std::make_shared<MappedFile>(mFileName, pattern);
+  }
+
   // Sets the given file's content.
   void setContent(std::vector<T> const& content) {
     mContent  = content;
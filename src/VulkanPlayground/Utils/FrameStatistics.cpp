@@ -0,0 +1,309 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "FrameStatistics.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace Illusion {
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// nearest-rank percentile of sorted samples
+double getPercentile(std::vector<double> const& sorted, double percentile) {
+  auto rank{static_cast<size_t>(std::ceil(percentile * sorted.size()))};
+  return sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool endsWith(std::string const& string, std::string const& suffix) {
+  return string.size() >= suffix.size() &&
+         string.compare(string.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::ofstream openFile(std::string const& fileName) {
+  std::ofstream file(fileName);
+  if (!file) { throw std::runtime_error{"Failed to write frame statistics \"" + fileName + "\"!"}; }
+
+  file << std::fixed << std::setprecision(3);
+  return file;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* FrameStatistics::getName(Metric metric) {
+  switch (metric) {
+  case Metric::eCpuFrameTime:
+    return "cpuFrameTime";
+  case Metric::eGpuFrameTime:
+    return "gpuFrameTime";
+  case Metric::eAcquireWait:
+    return "acquireWait";
+  case Metric::ePresentWait:
+    return "presentWait";
+  default:
+    return "unknown";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameStatistics::FrameStatistics(
+  uint32_t windowSize, double bucketMilliseconds, uint32_t bucketCount)
+  : mWindowSize(std::max(1u, windowSize))
+  , mBucketMilliseconds(bucketMilliseconds)
+  , mBucketCount(std::max(1u, bucketCount)) {
+
+  if (mBucketMilliseconds <= 0.0) {
+    throw std::runtime_error{"Failed to create frame statistics: Bucket size must be positive!"};
+  }
+
+  for (auto& window : mWindows) {
+    window.mSamples.reserve(mWindowSize);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameStatistics::add(Metric metric, double milliseconds) {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  auto& window = mWindows[static_cast<size_t>(metric)];
+
+  if (window.mSamples.size() < mWindowSize) {
+    window.mSamples.push_back(milliseconds);
+  } else {
+    window.mSamples[window.mNext] = milliseconds;
+  }
+
+  window.mNext = (window.mNext + 1) % mWindowSize;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameStatistics::finishFrame() {
+  std::string fileName;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    ++mFrameCount;
+
+    if (mDumpInterval == 0 || mFrameCount % mDumpInterval != 0) { return; }
+    fileName = mDumpFile;
+  }
+
+  // a failed dump should not take the application down
+  try {
+    if (endsWith(fileName, ".csv")) {
+      saveCsv(fileName);
+    } else {
+      saveJson(fileName);
+    }
+  } catch (std::exception const& e) { ILLUSION_WARNING << e.what() << std::endl; }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameStatistics::clear() {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  for (auto& window : mWindows) {
+    window.mSamples.clear();
+    window.mNext = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameStatistics::Summary FrameStatistics::getSummary(Metric metric) const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return summarize(metric);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint32_t> FrameStatistics::getHistogram(Metric metric) const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return histogram(metric);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint64_t FrameStatistics::getFrameCount() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mFrameCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameStatistics::saveJson(std::string const& fileName) const {
+  auto file = openFile(fileName);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  file << "{\"frameCount\":" << mFrameCount << ",\"windowSize\":" << mWindowSize
+       << ",\"bucketMilliseconds\":" << mBucketMilliseconds << ",\"metrics\":{" << std::endl;
+
+  for (size_t i{0}; i < mWindows.size(); ++i) {
+    auto metric{static_cast<Metric>(i)};
+    auto summary{summarize(metric)};
+
+    file << (i == 0 ? "" : ",\n") << "\"" << getName(metric)
+         << "\":{\"count\":" << summary.mSampleCount << ",\"min\":" << summary.mMin
+         << ",\"mean\":" << summary.mMean << ",\"p50\":" << summary.mP50
+         << ",\"p95\":" << summary.mP95 << ",\"p99\":" << summary.mP99
+         << ",\"max\":" << summary.mMax << ",\"histogram\":[";
+
+    auto counts{histogram(metric)};
+    for (size_t j{0}; j < counts.size(); ++j) {
+      file << (j == 0 ? "" : ",") << counts[j];
+    }
+
+    file << "]}";
+  }
+
+  file << "\n}}" << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameStatistics::saveCsv(std::string const& fileName) const {
+  auto file = openFile(fileName);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  file << "metric,count,min,mean,p50,p95,p99,max" << std::endl;
+
+  for (size_t i{0}; i < mWindows.size(); ++i) {
+    auto metric{static_cast<Metric>(i)};
+    auto summary{summarize(metric)};
+
+    file << getName(metric) << "," << summary.mSampleCount << "," << summary.mMin << ","
+         << summary.mMean << "," << summary.mP50 << "," << summary.mP95 << "," << summary.mP99
+         << "," << summary.mMax << std::endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameStatistics::saveHistogramCsv(std::string const& fileName) const {
+  auto file = openFile(fileName);
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  std::vector<std::vector<uint32_t>> counts;
+
+  file << "bucketMilliseconds";
+  for (size_t i{0}; i < mWindows.size(); ++i) {
+    file << "," << getName(static_cast<Metric>(i));
+    counts.push_back(histogram(static_cast<Metric>(i)));
+  }
+  file << std::endl;
+
+  // each line starts with the lower bound of its bucket
+  for (uint32_t bucket{0}; bucket < mBucketCount; ++bucket) {
+    file << bucket * mBucketMilliseconds;
+    for (auto const& metric : counts) {
+      file << "," << metric[bucket];
+    }
+    file << std::endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameStatistics::setDumpFile(std::string const& fileName, uint32_t frameInterval) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mDumpFile     = fileName;
+  mDumpInterval = frameInterval;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void FrameStatistics::printSummary() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  ILLUSION_MESSAGE << "Frame statistics of the last " << mWindowSize << " frames in ms:"
+                   << std::endl;
+  ILLUSION_MESSAGE << "      metric | count |    min |   mean |    p50 |    p95 |    p99 |    max"
+                   << std::endl;
+
+  for (size_t i{0}; i < mWindows.size(); ++i) {
+    auto metric{static_cast<Metric>(i)};
+    auto summary{summarize(metric)};
+
+    ILLUSION_MESSAGE << std::setw(12) << getName(metric) << " | " << std::setw(5)
+                     << summary.mSampleCount << std::fixed << std::setprecision(2) << " | "
+                     << std::setw(6) << summary.mMin << " | " << std::setw(6) << summary.mMean
+                     << " | " << std::setw(6) << summary.mP50 << " | " << std::setw(6)
+                     << summary.mP95 << " | " << std::setw(6) << summary.mP99 << " | "
+                     << std::setw(6) << summary.mMax << std::endl;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+FrameStatistics::Summary FrameStatistics::summarize(Metric metric) const {
+  Summary summary;
+
+  auto sorted{mWindows[static_cast<size_t>(metric)].mSamples};
+  if (sorted.empty()) { return summary; }
+
+  std::sort(sorted.begin(), sorted.end());
+
+  double sum{0.0};
+  for (double sample : sorted) {
+    sum += sample;
+  }
+
+  summary.mSampleCount = static_cast<uint32_t>(sorted.size());
+  summary.mMin         = sorted.front();
+  summary.mMean        = sum / sorted.size();
+  summary.mP50         = getPercentile(sorted, 0.50);
+  summary.mP95         = getPercentile(sorted, 0.95);
+  summary.mP99         = getPercentile(sorted, 0.99);
+  summary.mMax         = sorted.back();
+
+  return summary;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<uint32_t> FrameStatistics::histogram(Metric metric) const {
+  std::vector<uint32_t> counts(mBucketCount, 0);
+
+  // clamping before the conversion also catches infinite samples
+  double lastBucket{mBucketCount - 1.0};
+
+  for (double sample : mWindows[static_cast<size_t>(metric)].mSamples) {
+    auto bucket{std::min(std::max(0.0, sample / mBucketMilliseconds), lastBucket)};
+    ++counts[static_cast<uint32_t>(bucket)];
+  }
+
+  return counts;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
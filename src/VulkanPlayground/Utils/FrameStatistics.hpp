@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_UTILS_FRAME_STATISTICS_HPP
+#define ILLUSION_UTILS_FRAME_STATISTICS_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Illusion {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Keeps the last windowSize samples of a few per-frame metrics and summarizes their distribution.
+// Each Graphics::Surface owns one and feeds it from beginFrame() and endFrame(), so any
+// application gets these numbers without further work. The summaries are computed on demand by
+// sorting a copy of the window; recording a sample only locks a mutex and stores one value, the
+// mutex is held briefly and is not contended unless the statistics are read from another thread.
+// With setDumpFile(), the summaries and histograms are written to a JSON or CSV file every few
+// frames.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class FrameStatistics;
+typedef std::shared_ptr<FrameStatistics> FrameStatisticsPtr;
+
+// -------------------------------------------------------------------------------------------------
+class FrameStatistics {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  enum class Metric {
+    // time between the beginnings of two consecutive frames on the CPU
+    eCpuFrameTime,
+
+    // time between the first and the last command of a frame on the GPU
+    eGpuFrameTime,
+
+    // time the CPU waited for a frame in flight to finish and for the next swap chain image
+    eAcquireWait,
+
+    // time the CPU spent in vkQueuePresentKHR
+    ePresentWait,
+
+    eCount
+  };
+
+  struct Summary {
+    uint32_t mSampleCount{0};
+    double   mMin{0.0};
+    double   mMean{0.0};
+    double   mP50{0.0};
+    double   mP95{0.0};
+    double   mP99{0.0};
+    double   mMax{0.0};
+  };
+
+  // ------------------------------------------------------------------------- public static methods
+  // A camel case name like "cpuFrameTime", used as key in the dumped files.
+  static const char* getName(Metric metric);
+
+  // -------------------------------------------------------------------------------- public methods
+  // The histograms have bucketCount buckets of bucketMilliseconds each; the last bucket also
+  // contains all larger samples.
+  explicit FrameStatistics(
+    uint32_t windowSize = 1000, double bucketMilliseconds = 0.5, uint32_t bucketCount = 100);
+
+  // Once the window is full, each sample replaces the oldest one of its metric.
+  void add(Metric metric, double milliseconds);
+
+  // Counts the frame and writes the dump file if it is due.
+  void finishFrame();
+
+  // Removes all samples, for example after a warm-up phase.
+  void clear();
+
+  Summary               getSummary(Metric metric) const;
+  std::vector<uint32_t> getHistogram(Metric metric) const;
+  uint64_t              getFrameCount() const;
+
+  // The JSON file contains the summaries and the histograms of all metrics. The CSV file contains
+  // one line per metric with its summary; saveHistogramCsv() writes one line per bucket instead.
+  void saveJson(std::string const& fileName) const;
+  void saveCsv(std::string const& fileName) const;
+  void saveHistogramCsv(std::string const& fileName) const;
+
+  // Every frameInterval frames, the statistics are written to the given file; the format is CSV if
+  // the name ends with ".csv" and JSON otherwise. An interval of zero disables the dumps.
+  void setDumpFile(std::string const& fileName, uint32_t frameInterval);
+
+  void printSummary() const;
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct Window {
+    std::vector<double> mSamples;
+    size_t              mNext{0};
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  // these expect the mutex to be locked
+  Summary               summarize(Metric metric) const;
+  std::vector<uint32_t> histogram(Metric metric) const;
+
+  // ------------------------------------------------------------------------------- private members
+  uint32_t mWindowSize;
+  double   mBucketMilliseconds;
+  uint32_t mBucketCount;
+
+  std::array<Window, static_cast<size_t>(Metric::eCount)> mWindows;
+
+  uint64_t    mFrameCount{0};
+  std::string mDumpFile;
+  uint32_t    mDumpInterval{0};
+
+  mutable std::mutex mMutex;
+};
+}
+
+#endif // ILLUSION_UTILS_FRAME_STATISTICS_HPP
@@ -0,0 +1,38 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_UTILS_HASH_HPP
+#define ILLUSION_UTILS_HASH_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include <cstddef>
+#include <cstdint>
+
+namespace Illusion {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// 64 bit FNV-1a hash. This is not a cryptographic hash; it is used to detect corrupt cache files  //
+// and to key caches by content. Pass a previous result as seed to hash several ranges at once.   //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+inline uint64_t hashBytes(void const* data, size_t size, uint64_t seed = 14695981039346656037ull) {
+  auto     bytes = static_cast<uint8_t const*>(data);
+  uint64_t hash{seed};
+
+  for (size_t i{0}; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+}
+
+#endif // ILLUSION_UTILS_HASH_HPP
@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "JobSystem.hpp"
+
+#include "Profiler.hpp"
+
+namespace Illusion {
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// each worker knows to which system it belongs and which deque is its own
+thread_local JobSystem const* tJobSystem{nullptr};
+thread_local uint32_t         tWorker{0};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+JobSystem::JobSystem(uint32_t threadCount) {
+  threadCount = std::max(1u, threadCount);
+
+  for (uint32_t i{0}; i < threadCount; ++i) {
+    mWorkers.emplace_back(new Worker());
+  }
+
+  // the deques have to exist before the first worker starts stealing
+  for (uint32_t i{0}; i < threadCount; ++i) {
+    mWorkers[i]->mThread = std::thread(&JobSystem::workerLoop, this, i);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+JobSystem::~JobSystem() {
+  wait();
+
+  {
+    std::lock_guard<std::mutex> lock(mSleepMutex);
+    mStop = true;
+  }
+
+  mWakeUp.notify_all();
+
+  for (auto& worker : mWorkers) {
+    worker->mThread.join();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void JobSystem::wait(JobGroup const& group) {
+  while (!group.isDone()) {
+    if (!runPendingJob()) { std::this_thread::yield(); }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void JobSystem::wait() {
+  while (mPendingJobs > 0) {
+    if (!runPendingJob()) { std::this_thread::yield(); }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void JobSystem::push(std::function<void()>&& job) {
+  uint32_t worker{tJobSystem == this ? tWorker : mNextWorker++ % getThreadCount()};
+
+  ++mPendingJobs;
+
+  {
+    std::lock_guard<std::mutex> lock(mWorkers[worker]->mMutex);
+    mWorkers[worker]->mJobs.push_back(std::move(job));
+  }
+
+  ++mQueuedJobs;
+
+  // a worker increments mSleepingWorkers before it checks mQueuedJobs, so either it sees the new
+  // job or we see the sleeping worker; taking the lock ensures that it is actually waiting
+  if (mSleepingWorkers > 0) {
+    { std::lock_guard<std::mutex> lock(mSleepMutex); }
+    mWakeUp.notify_one();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool JobSystem::pop(uint32_t worker, std::function<void()>& job) {
+  uint32_t count{getThreadCount()};
+
+  // the own deque is used like a stack, recently pushed jobs are likely to be hot in the cache
+  if (worker < count) {
+    std::lock_guard<std::mutex> lock(mWorkers[worker]->mMutex);
+    if (!mWorkers[worker]->mJobs.empty()) {
+      job = std::move(mWorkers[worker]->mJobs.back());
+      mWorkers[worker]->mJobs.pop_back();
+      --mQueuedJobs;
+      return true;
+    }
+  }
+
+  // other deques are used like queues, the oldest jobs are likely to spawn more work
+  for (uint32_t i{1}; i <= count; ++i) {
+    auto& victim = *mWorkers[(worker + i) % count];
+
+    std::lock_guard<std::mutex> lock(victim.mMutex);
+    if (!victim.mJobs.empty()) {
+      job = std::move(victim.mJobs.front());
+      victim.mJobs.pop_front();
+      --mQueuedJobs;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool JobSystem::runPendingJob() {
+  std::function<void()> job;
+
+  if (!pop(tJobSystem == this ? tWorker : getThreadCount(), job)) { return false; }
+
+  job();
+  --mPendingJobs;
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void JobSystem::workerLoop(uint32_t worker) {
+  tJobSystem = this;
+  tWorker    = worker;
+
+  Profiler::setThreadName("JobSystem worker " + std::to_string(worker));
+
+  while (true) {
+    if (runPendingJob()) { continue; }
+
+    std::unique_lock<std::mutex> lock(mSleepMutex);
+    ++mSleepingWorkers;
+    mWakeUp.wait(lock, [this]() { return mQueuedJobs > 0 || mStop; });
+    --mSleepingWorkers;
+
+    if (mStop && mQueuedJobs == 0) { return; }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_UTILS_JOB_SYSTEM_HPP
+#define ILLUSION_UTILS_JOB_SYSTEM_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Illusion {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A pool of worker threads with one job deque per worker. Jobs which are enqueued from within a  //
+// job go to the deque of the current worker, other jobs are distributed round-robin. Each worker //
+// takes jobs from the back of its own deque and steals from the front of the others' deques if  //
+// its own one is empty. Idle workers sleep until new jobs arrive.                                //
+// enqueue() returns a future for the result of the job; exceptions are rethrown by get(). Jobs   //
+// can be counted by a JobGroup. wait() and parallelFor() execute pending jobs on the calling     //
+// thread while waiting, so they may be used from within jobs as well. Blocking on a future from  //
+// within a job however may dead-lock if all workers do this.                                     //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class JobGroup {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  JobGroup() = default;
+
+  JobGroup(JobGroup const& other) = delete;
+  JobGroup& operator=(JobGroup const& other) = delete;
+
+  // Returns true if all jobs enqueued for this group have been executed.
+  bool isDone() const { return mPendingJobs == 0; }
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  friend class JobSystem;
+
+  std::atomic<uint32_t> mPendingJobs{0};
+};
+
+// -------------------------------------------------------------------------------------------------
+class JobSystem {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  explicit JobSystem(uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency()));
+
+  // Executes all pending jobs before the workers are joined.
+  virtual ~JobSystem();
+
+  // Adds a new job which is executed on one of the worker threads.
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> enqueue(F job) {
+    return enqueueImpl(nullptr, std::move(job));
+  }
+
+  // Same as above, the job is counted by the given group. The group must outlive the job.
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> enqueue(JobGroup& group, F job) {
+    return enqueueImpl(&group, std::move(job));
+  }
+
+  // Calls function(i) for each i in [begin, end) and returns once all calls have finished. The
+  // range is split into chunks of chunkSize indices; if chunkSize is zero, there will be about four
+  // chunks per worker. The first exception thrown by function is rethrown.
+  template <typename F>
+  void parallelFor(size_t begin, size_t end, F function, size_t chunkSize = 0) {
+    if (begin >= end) { return; }
+
+    if (chunkSize == 0) {
+      chunkSize = std::max<size_t>(1, (end - begin) / (getThreadCount() * 4));
+    }
+
+    JobGroup                       group;
+    std::vector<std::future<void>> chunks;
+
+    for (size_t chunkBegin{begin}; chunkBegin < end; chunkBegin += chunkSize) {
+      size_t chunkEnd{std::min(end, chunkBegin + chunkSize)};
+
+      chunks.push_back(enqueue(group, [chunkBegin, chunkEnd, &function]() {
+        for (size_t i{chunkBegin}; i < chunkEnd; ++i) {
+          function(i);
+        }
+      }));
+    }
+
+    wait(group);
+
+    for (auto& chunk : chunks) {
+      chunk.get();
+    }
+  }
+
+  // Executes pending jobs on the calling thread until all jobs of the group have finished.
+  void wait(JobGroup const& group);
+
+  // Executes pending jobs on the calling thread until all jobs have finished.
+  void wait();
+
+  uint32_t getThreadCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct Worker {
+    std::deque<std::function<void()>> mJobs;
+    std::mutex                        mMutex;
+    std::thread                       mThread;
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  template <typename F>
+  std::future<typename std::result_of<F()>::type> enqueueImpl(JobGroup* group, F job) {
+    typedef typename std::result_of<F()>::type Result;
+
+    // std::function requires a copyable target, hence the shared_ptr
+    auto task{std::make_shared<std::packaged_task<Result()>>(std::move(job))};
+    auto result{task->get_future()};
+
+    if (group) { ++group->mPendingJobs; }
+
+    // packaged_task stores exceptions in the future, so the counter is always decremented
+    push([task, group]() {
+      (*task)();
+      if (group) { --group->mPendingJobs; }
+    });
+
+    return result;
+  }
+
+  void push(std::function<void()>&& job);
+
+  // takes a job from the deque of the given worker or steals one from the others; pass
+  // getThreadCount() to steal only
+  bool pop(uint32_t worker, std::function<void()>& job);
+
+  // executes one pending job, returns false if there was none
+  bool runPendingJob();
+
+  void workerLoop(uint32_t worker);
+
+  // ------------------------------------------------------------------------------- private members
+  std::vector<std::unique_ptr<Worker>> mWorkers;
+
+  // jobs which have been pushed but not yet popped and jobs which have not yet finished
+  std::atomic<uint32_t> mQueuedJobs{0};
+  std::atomic<uint32_t> mPendingJobs{0};
+  std::atomic<uint32_t> mNextWorker{0};
+  std::atomic<uint32_t> mSleepingWorkers{0};
+
+  bool                    mStop{false};
+  std::mutex              mSleepMutex;
+  std::condition_variable mWakeUp;
+};
+}
+
+#endif // ILLUSION_UTILS_JOB_SYSTEM_HPP
@@ -11,8 +11,16 @@
 // ---------------------------------------------------------------------------------------- includes
 #include "Logger.hpp"
 
+#include "LoggerSinks.hpp"
+#include "Queue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 
 namespace Illusion {
 
@@ -23,6 +31,7 @@ bool Logger::enableDebug   = true;
 bool Logger::enableMessage = true;
 bool Logger::enableWarning = true;
 bool Logger::enableError   = true;
+bool Logger::enableAsync   = true;
 
 // no colors on windows!
 #if defined(_WIN32)
@@ -93,14 +102,253 @@ std::string locationString(const char* f, int l)
   return sstr.str();
 }
 
-std::ostream& print(bool enable, std::string const& header, std::string const& color,
-                    const char* file, int line)
-{
-  if (enable) {
-    return std::cout << color << header << locationString(file, line) << Logger::PRINT_RESET << " ";
+struct Record {
+  Logger::Level mLevel;
+  std::string   mLocation;
+  std::string   mMessage;
+
+  // If this is not zero, the record contains no message but marks a call to Logger::flush().
+  uint64_t mFlushTicket{0};
+};
+
+// Set when the Backend or the stream of the current thread has been destroyed at exit. Messages
+// are printed directly to std::cout afterwards.
+std::atomic<bool> backendDestroyed{false};
+thread_local bool streamDestroyed{false};
+
+std::ostream& printHeader(std::ostream& stream, Logger::Level level, std::string const& location) {
+  static std::string const* colors[] = {&Logger::PRINT_TURQUOISE, &Logger::PRINT_BLUE,
+    &Logger::PRINT_GREEN, &Logger::PRINT_YELLOW, &Logger::PRINT_RED};
+
+  return stream << *colors[static_cast<int>(level)] << Logger::getHeader(level) << location
+                << Logger::PRINT_RESET << " ";
+}
+
+// Owns the sinks and the thread which writes the queued messages to them.
+class Backend {
+ public:
+  Backend()
+    : mSinks{std::make_shared<Logger::StdoutSink>()}
+    , mThread(&Backend::run, this) {}
+
+  ~Backend() {
+    // messages of later static destructors are printed directly
+    backendDestroyed = true;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mWakeUp.notify_all();
+    mThread.join();
+  }
+
+  void push(Record&& record) {
+    mQueue.push(std::move(record));
+    ++mPushedCount;
+
+    // the thread only sleeps without timeout if it has been idle for a while
+    if (mSleeping.load()) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mWakeUp.notify_one();
+    }
+  }
+
+  void write(Record const& record) {
+    std::lock_guard<std::mutex> lock(mSinkMutex);
+    for (auto const& sink : mSinks) {
+      sink->write(record.mLevel, record.mLocation, record.mMessage);
+      sink->flush();
+    }
+  }
+
+  // Waits until a marker is written which is queued behind all messages pushed before. The tickets
+  // are handed out and queued under the mutex, so they are written in ascending order.
+  void flush() {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    Record marker;
+    marker.mFlushTicket = ++mLastTicket;
+
+    uint64_t ticket{marker.mFlushTicket};
+    mQueue.push(std::move(marker));
+    ++mPushedCount;
+
+    mFlushRequested = true;
+    mWakeUp.notify_all();
+    mFlushed.wait(lock, [this, ticket]() { return mFlushedTicket >= ticket || mStop; });
+  }
+
+  void setSinks(std::vector<std::shared_ptr<Logger::Sink>> const& sinks) {
+    flush();
+    std::lock_guard<std::mutex> lock(mSinkMutex);
+    mSinks = sinks;
+  }
+
+  std::vector<std::shared_ptr<Logger::Sink>> getSinks() {
+    std::lock_guard<std::mutex> lock(mSinkMutex);
+    return mSinks;
+  }
+
+ private:
+  // writes all queued messages and returns how many records there were; flushTicket is set to the
+  // ticket of the last flush marker among them
+  uint64_t writeQueued(uint64_t& flushTicket) {
+    std::lock_guard<std::mutex> lock(mSinkMutex);
+
+    uint64_t count{0};
+    Record   record;
+
+    while (mQueue.tryPop(record)) {
+      if (record.mFlushTicket > 0) {
+        flushTicket = record.mFlushTicket;
+      } else {
+        for (auto const& sink : mSinks) {
+          sink->write(record.mLevel, record.mLocation, record.mMessage);
+        }
+      }
+      ++count;
+    }
+
+    if (count > 0) {
+      for (auto const& sink : mSinks) {
+        sink->flush();
+      }
+    }
+
+    return count;
+  }
+
+  void run() {
+    while (true) {
+      uint64_t ticket{0};
+      uint64_t count{writeQueued(ticket)};
+
+      // the sinks have been flushed already
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWrittenCount += count;
+
+      if (ticket > 0) {
+        mFlushedTicket = ticket;
+        mFlushed.notify_all();
+      }
+
+      if (mStop) {
+        lock.unlock();
+        writeQueued(ticket);
+        return;
+      }
+
+      if (mFlushRequested) {
+        mFlushRequested = false;
+        continue;
+      }
+
+      // wait a bit to collect more messages, if there are none afterwards sleep until the next
+      // message comes in
+      if (count > 0) {
+        mWakeUp.wait_for(lock, std::chrono::milliseconds(2));
+      } else {
+        mSleeping = true;
+        if (mPushedCount.load() == mWrittenCount) {
+          mWakeUp.wait(lock, [this]() {
+            return mStop || mFlushRequested || mPushedCount.load() != mWrittenCount;
+          });
+        }
+        mSleeping = false;
+      }
+    }
+  }
+
+  UnboundedQueue<Record>                     mQueue;
+  std::vector<std::shared_ptr<Logger::Sink>> mSinks;
+  std::mutex                                 mSinkMutex;
+
+  std::atomic<uint64_t> mPushedCount{0};
+  uint64_t              mWrittenCount{0};
+  uint64_t              mLastTicket{0};
+  uint64_t              mFlushedTicket{0};
+  std::atomic<bool>     mSleeping{false};
+  bool                  mFlushRequested{false};
+  bool                  mStop{false};
+
+  std::mutex              mMutex;
+  std::condition_variable mWakeUp;
+  std::condition_variable mFlushed;
+  std::thread             mThread;
+};
+
+Backend& getBackend() {
+  static Backend backend;
+  return backend;
+}
+
+void submit(Record&& record) {
+  if (backendDestroyed) {
+    printHeader(std::cout, record.mLevel, record.mLocation) << record.mMessage << std::flush;
+  } else if (Logger::enableAsync) {
+    getBackend().push(std::move(record));
   } else {
-    return devNull;
+    getBackend().write(record);
+  }
+}
+
+// Collects the characters of one message. The message is submitted when the stream is flushed
+// or when the next message is started on the same thread.
+class MessageBuffer : public std::streambuf {
+ public:
+  ~MessageBuffer() { submitPending(); }
+
+  void begin(Logger::Level level, std::string&& location) {
+    submitPending();
+    mRecord.mLevel    = level;
+    mRecord.mLocation = std::move(location);
+  }
+
+ protected:
+  int overflow(int c) override {
+    if (c != traits_type::eof()) { mRecord.mMessage.push_back(static_cast<char>(c)); }
+    return c;
+  }
+
+  std::streamsize xsputn(const char* s, std::streamsize n) override {
+    mRecord.mMessage.append(s, static_cast<size_t>(n));
+    return n;
+  }
+
+  int sync() override {
+    submitPending();
+    return 0;
+  }
+
+ private:
+  void submitPending() {
+    if (!mRecord.mMessage.empty()) {
+      submit(std::move(mRecord));
+      mRecord.mMessage.clear();
+    }
   }
+
+  Record mRecord;
+};
+
+struct ThreadStream {
+  ~ThreadStream() { streamDestroyed = true; }
+
+  MessageBuffer mBuffer;
+  std::ostream  mStream{&mBuffer};
+};
+
+std::ostream& print(bool enable, Logger::Level level, const char* file, int line) {
+  if (!enable) { return devNull; }
+
+  if (backendDestroyed || streamDestroyed) {
+    return printHeader(std::cout, level, locationString(file, line));
+  }
+
+  static thread_local ThreadStream stream;
+  stream.mBuffer.begin(level, locationString(file, line));
+  return stream.mStream;
 }
 }
 
@@ -108,35 +356,116 @@ std::ostream& print(bool enable, std::string const& header, std::string const& c
 
 std::ostream& Logger::traceImpl(const char* file, int line)
 {
-  return print(enableTrace, "[ILLUSION][T]", PRINT_TURQUOISE, file, line);
+  return print(enableTrace, Level::eTrace, file, line);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::ostream& Logger::debugImpl(const char* file, int line)
 {
-  return print(enableDebug, "[ILLUSION][D]", PRINT_BLUE, file, line);
+  return print(enableDebug, Level::eDebug, file, line);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::ostream& Logger::messageImpl(const char* file, int line)
 {
-  return print(enableMessage, "[ILLUSION][M]", PRINT_GREEN, file, line);
+  return print(enableMessage, Level::eMessage, file, line);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::ostream& Logger::warningImpl(const char* file, int line)
 {
-  return print(enableWarning, "[ILLUSION][W]", PRINT_YELLOW, file, line);
+  return print(enableWarning, Level::eWarning, file, line);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::ostream& Logger::errorImpl(const char* file, int line)
 {
-  return print(enableError, "[ILLUSION][E]", PRINT_RED, file, line);
+  return print(enableError, Level::eError, file, line);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+void Logger::flush() {
+  if (!backendDestroyed) { getBackend().flush(); }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Logger::Sink::setAll(std::vector<std::shared_ptr<Sink>> const& sinks) {
+  getBackend().setSinks(sinks);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::shared_ptr<Logger::Sink>> Logger::Sink::getAll() {
+  return getBackend().getSinks();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string const& Logger::getHeader(Level level) {
+  static const std::string headers[] = {
+    "[ILLUSION][T]", "[ILLUSION][D]", "[ILLUSION][M]", "[ILLUSION][W]", "[ILLUSION][E]"};
+  return headers[static_cast<int>(level)];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Logger::StdoutSink::write(
+  Level level, std::string const& location, std::string const& message) {
+
+  printHeader(std::cout, level, location) << message;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Logger::StdoutSink::flush() { std::cout.flush(); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Logger::FileSink::FileSink(std::string const& fileName)
+  : mFile(fileName, std::ios::out | std::ios::app) {
+
+  if (!mFile) { throw std::runtime_error{"Failed to open log file \"" + fileName + "\"!"}; }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Logger::FileSink::write(
+  Level level, std::string const& location, std::string const& message) {
+  mFile << getHeader(level) << location << " " << message;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Logger::FileSink::flush() { mFile.flush(); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Logger::RingSink::RingSink(size_t capacity)
+  : mCapacity(capacity) {}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Logger::RingSink::write(
+  Level level, std::string const& location, std::string const& message) {
+
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  if (mCapacity == 0) { return; }
+  if (mMessages.size() == mCapacity) { mMessages.pop_front(); }
+
+  mMessages.push_back(getHeader(level) + location + " " + message);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<std::string> Logger::RingSink::getMessages() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return std::vector<std::string>(mMessages.begin(), mMessages.end());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
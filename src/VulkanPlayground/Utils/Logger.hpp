@@ -18,13 +18,26 @@
 namespace Illusion {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-// Prints beautiful messages to the console output.                                               //
+// Prints beautiful messages to the console output. The ILLUSION_* macros return a thread local   //
+// stream; each message is collected there and handed over as a whole once the stream is flushed  //
+// (usually by std::endl). If enableAsync is set, the messages are passed through a lock-free     //
+// queue to a background thread which writes them to the sinks. Hence logging never blocks on     //
+// terminal or file I/O. Call Logger::flush() to wait until all messages have been written.       //
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // -------------------------------------------------------------------------------------------------
 class Logger {
 
  public:
+  // -------------------------------------------------------------------------------- public classes
+  enum class Level { eTrace, eDebug, eMessage, eWarning, eError };
+
+  // The messages are written to sinks, see LoggerSinks.hpp.
+  class Sink;
+  class StdoutSink;
+  class FileSink;
+  class RingSink;
+
   // ------------------------------------------------------------------- public static const members
   const static std::string PRINT_RED;
   const static std::string PRINT_GREEN;
@@ -53,22 +66,45 @@ class Logger {
   static bool enableWarning; // messages are discarded.
   static bool enableError;
 
+  // If set to false, each message is written to the sinks by the thread which logs it.
+  static bool enableAsync;
+
   // ------------------------------------------------------------------------- public static methods
   static std::ostream& traceImpl(const char* file, int line);
   static std::ostream& debugImpl(const char* file, int line);
   static std::ostream& messageImpl(const char* file, int line);
   static std::ostream& warningImpl(const char* file, int line);
   static std::ostream& errorImpl(const char* file, int line);
+
+  // Blocks until all messages which have been completed before this call are written to the sinks
+  // and the sinks are flushed. This is done automatically when the program exits.
+  static void flush();
+
+  // Returns the header (e.g. "[ILLUSION][W]") of the given level.
+  static std::string const& getHeader(Level level);
 };
 
 // ------------------------------------------------------------------------------------------ macros
 // Use these macros in your code like this:
-//   LOG_MESSAGE << "hello world" << std::endl;
-#define ILLUSION_TRACE Logger::traceImpl(__FILE__, __LINE__)
-#define ILLUSION_DEBUG Logger::debugImpl(__FILE__, __LINE__)
-#define ILLUSION_MESSAGE Logger::messageImpl(__FILE__, __LINE__)
-#define ILLUSION_WARNING Logger::warningImpl(__FILE__, __LINE__)
-#define ILLUSION_ERROR Logger::errorImpl(__FILE__, __LINE__)
+//   ILLUSION_MESSAGE << "hello world" << std::endl;
+// If a level is disabled, the operands are not evaluated at all. Levels below
+// ILLUSION_MIN_LOG_LEVEL (0: trace, 1: debug, 2: message, 3: warning, 4: error) are removed at
+// compile time; the operands are still type checked in this case.
+#ifndef ILLUSION_MIN_LOG_LEVEL
+#define ILLUSION_MIN_LOG_LEVEL 0
+#endif
+
+// The loop runs at most once; unlike an if-else, it cannot capture a following else.
+#define ILLUSION_LOG_IMPL(level, enable, impl)                                                     \
+  for (bool illusionLogOnce = level >= ILLUSION_MIN_LOG_LEVEL && ::Illusion::Logger::enable;       \
+       illusionLogOnce; illusionLogOnce = false)                                                   \
+    ::Illusion::Logger::impl(__FILE__, __LINE__)
+
+#define ILLUSION_TRACE ILLUSION_LOG_IMPL(0, enableTrace, traceImpl)
+#define ILLUSION_DEBUG ILLUSION_LOG_IMPL(1, enableDebug, debugImpl)
+#define ILLUSION_MESSAGE ILLUSION_LOG_IMPL(2, enableMessage, messageImpl)
+#define ILLUSION_WARNING ILLUSION_LOG_IMPL(3, enableWarning, warningImpl)
+#define ILLUSION_ERROR ILLUSION_LOG_IMPL(4, enableError, errorImpl)
 }
 
 #endif // ILLUSION_LOGGER_HPP
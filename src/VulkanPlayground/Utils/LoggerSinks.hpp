@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_UTILS_LOGGER_SINKS_HPP
+#define ILLUSION_UTILS_LOGGER_SINKS_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "Logger.hpp"
+
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Illusion {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A Sink receives complete messages of the Logger, including the trailing newline. The sinks are //
+// called by one thread at a time only. By default, there is one StdoutSink.                      //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+class Logger::Sink {
+
+ public:
+  // ------------------------------------------------------------------------- public static methods
+  // Pending messages are written to the old sinks before the new ones are used.
+  static void setAll(std::vector<std::shared_ptr<Sink>> const& sinks);
+  static std::vector<std::shared_ptr<Sink>> getAll();
+
+  // -------------------------------------------------------------------------------- public methods
+  virtual ~Sink() {}
+
+  virtual void write(Level level, std::string const& location, std::string const& message) = 0;
+  virtual void flush() {}
+};
+
+// -------------------------------------------------------------------------------------------------
+// Writes colored messages to std::cout.
+class Logger::StdoutSink : public Logger::Sink {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  void write(Level level, std::string const& location, std::string const& message) override;
+  void flush() override;
+};
+
+// -------------------------------------------------------------------------------------------------
+// Appends uncolored messages to the given file.
+class Logger::FileSink : public Logger::Sink {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  explicit FileSink(std::string const& fileName);
+
+  void write(Level level, std::string const& location, std::string const& message) override;
+  void flush() override;
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  std::ofstream mFile;
+};
+
+// -------------------------------------------------------------------------------------------------
+// Keeps the last capacity messages in memory, for example to show them in a user interface.
+class Logger::RingSink : public Logger::Sink {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  explicit RingSink(size_t capacity = 1000);
+
+  void write(Level level, std::string const& location, std::string const& message) override;
+
+  // Returns the stored messages, oldest first.
+  std::vector<std::string> getMessages() const;
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  size_t                  mCapacity;
+  std::deque<std::string> mMessages;
+  mutable std::mutex      mMutex;
+};
+}
+
+#endif // ILLUSION_UTILS_LOGGER_SINKS_HPP
@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "MappedFile.hpp"
+
+#include "Logger.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Illusion {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile(std::string const& fileName, AccessPattern pattern, bool allowMapping)
+  : mFileName(fileName) {
+
+#if defined(_WIN32)
+  readBuffered();
+#else
+  if (!allowMapping) {
+    readBuffered();
+    return;
+  }
+
+  int file{open(fileName.c_str(), O_RDONLY | O_CLOEXEC)};
+  if (file < 0) {
+    throw std::runtime_error{"Failed to open file \"" + fileName + "\": " + std::strerror(errno)};
+  }
+
+  struct stat info;
+  if (fstat(file, &info) != 0) {
+    close(file);
+    throw std::runtime_error{"Failed to open file \"" + fileName + "\": " + std::strerror(errno)};
+  }
+
+  mSize = static_cast<size_t>(info.st_size);
+
+  // empty files cannot be mapped
+  if (mSize > 0) {
+    void* mapping{mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0)};
+
+    if (mapping != MAP_FAILED) {
+      mMapping = mapping;
+      mData    = static_cast<uint8_t const*>(mapping);
+
+      int advice{MADV_NORMAL};
+      if (pattern == AccessPattern::eSequential) {
+        advice = MADV_SEQUENTIAL;
+      } else if (pattern == AccessPattern::eRandom) {
+        advice = MADV_RANDOM;
+      }
+
+      // this is only a hint, failure is not an error
+      madvise(mapping, mSize, advice);
+    } else {
+      ILLUSION_DEBUG << "Failed to map file \"" << fileName << "\": " << std::strerror(errno)
+                     << ". Reading it instead." << std::endl;
+    }
+  }
+
+  close(file);
+
+  if (mSize > 0 && !mMapping) { readBuffered(); }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+  if (mMapping) { munmap(mMapping, mSize); }
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MappedFile::readBuffered() {
+  std::ifstream stream(mFileName, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!stream) { throw std::runtime_error{"Failed to open file \"" + mFileName + "\"!"}; }
+
+  mSize = static_cast<size_t>(stream.tellg());
+  stream.seekg(0, std::ios::beg);
+
+  mBuffer.resize(mSize);
+  if (!stream.read(reinterpret_cast<char*>(mBuffer.data()), mSize)) {
+    throw std::runtime_error{"Failed to read file \"" + mFileName + "\"!"};
+  }
+
+  mData = mBuffer.data();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_UTILS_MAPPED_FILE_HPP
+#define ILLUSION_UTILS_MAPPED_FILE_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include "Span.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Illusion {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A read-only view onto the content of a file. On POSIX systems the file is mapped into memory,  //
+// so its content is paged in on demand and never copied to the heap. The access pattern is       //
+// passed to the kernel with madvise(). If the file cannot be mapped (or on other platforms), it  //
+// is read into a buffer instead. The view stays valid as long as the MappedFile exists, so       //
+// usually it is passed around as a MappedFilePtr.                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class MappedFile;
+typedef std::shared_ptr<MappedFile> MappedFilePtr;
+
+// -------------------------------------------------------------------------------------------------
+class MappedFile {
+
+ public:
+  // -------------------------------------------------------------------------------- public classes
+  enum class AccessPattern { eNormal, eSequential, eRandom };
+
+  // -------------------------------------------------------------------------------- public methods
+  // Throws a std::runtime_error if the file cannot be opened. If allowMapping is false, the file is
+  // always read into a buffer.
+  MappedFile(
+    std::string const& fileName,
+    AccessPattern      pattern      = AccessPattern::eSequential,
+    bool               allowMapping = true);
+  virtual ~MappedFile();
+
+  MappedFile(MappedFile const& other) = delete;
+  MappedFile& operator=(MappedFile const& other) = delete;
+
+  // Returns the content interpreted as elements of type T. Trailing bytes which do not make up an
+  // entire element are not part of the span.
+  template <typename T>
+  Span<T const> getSpan() const {
+    return Span<T const>(reinterpret_cast<T const*>(mData), mSize / sizeof(T));
+  }
+
+  uint8_t const*     getData() const { return mData; }
+  size_t             getSize() const { return mSize; }
+  std::string const& getFileName() const { return mFileName; }
+
+  // Returns false if the content has been read into a buffer.
+  bool isMapped() const { return mMapping != nullptr; }
+
+ private:
+  // ------------------------------------------------------------------------------- private methods
+  void readBuffered();
+
+  // ------------------------------------------------------------------------------- private members
+  std::string          mFileName;
+  uint8_t const*       mData{nullptr};
+  size_t               mSize{0};
+  void*                mMapping{nullptr};
+  std::vector<uint8_t> mBuffer;
+};
+}
+
+#endif // ILLUSION_UTILS_MAPPED_FILE_HPP
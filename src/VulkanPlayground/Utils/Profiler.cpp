@@ -0,0 +1,311 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// ---------------------------------------------------------------------------------------- includes
+#include "Profiler.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace Illusion {
+
+std::atomic<bool> Profiler::enabled{false};
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct Event {
+  const char* mName;
+  uint64_t    mStart;
+  uint64_t    mEnd;
+};
+
+// Blocks are only appended to by their thread. Readers see all events below mCount.
+struct Block {
+  static const size_t SIZE = 2048;
+
+  Event               mEvents[SIZE];
+  std::atomic<size_t> mCount{0};
+  std::atomic<Block*> mNext{nullptr};
+};
+}
+
+// The blocks are never freed, see getRegistry().
+struct Profiler::Track {
+  uint32_t            mId{0};
+  std::string         mName;
+  std::atomic<Block*> mFirst{nullptr};
+  Block*              mLast{nullptr};
+};
+
+namespace {
+
+struct Registry {
+  std::mutex                                    mMutex;
+  std::vector<std::unique_ptr<Profiler::Track>> mTracks;
+  std::unordered_set<std::string>               mNames;
+  uint64_t                                      mClearTime{0};
+};
+
+// This is never destroyed, so zones may still be recorded in static destructors.
+Registry& getRegistry() {
+  static Registry* registry{new Registry()};
+  return *registry;
+}
+
+Profiler::Track* addTrack(std::string const& name) {
+  auto& registry = getRegistry();
+
+  std::lock_guard<std::mutex> lock(registry.mMutex);
+  registry.mTracks.emplace_back(new Profiler::Track());
+  registry.mTracks.back()->mId   = static_cast<uint32_t>(registry.mTracks.size());
+  registry.mTracks.back()->mName = name;
+
+  return registry.mTracks.back().get();
+}
+
+thread_local Profiler::Track* tTrack{nullptr};
+
+Profiler::Track& getThreadTrack() {
+  if (!tTrack) { tTrack = addTrack(""); }
+  return *tTrack;
+}
+
+// Calls visitor(track, event) for all events recorded after the last clear().
+template <typename F>
+void forEachEvent(F visitor) {
+  auto& registry = getRegistry();
+
+  std::lock_guard<std::mutex> lock(registry.mMutex);
+
+  for (auto const& track : registry.mTracks) {
+    for (Block* block{track->mFirst.load()}; block; block = block->mNext.load()) {
+      size_t count{block->mCount.load(std::memory_order_acquire)};
+
+      for (size_t i{0}; i < count; ++i) {
+        if (block->mEvents[i].mStart >= registry.mClearTime) {
+          visitor(*track, block->mEvents[i]);
+        }
+      }
+    }
+  }
+}
+
+std::string escape(std::string const& value) {
+  std::string result;
+
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      result.push_back('\\');
+      result.push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      result.push_back(' ');
+    } else {
+      result.push_back(c);
+    }
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+  record(&getThreadTrack(), name, start, end);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Profiler::Track* Profiler::createTrack(std::string const& name) { return addTrack(name); }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::record(Track* track, const char* name, uint64_t start, uint64_t end) {
+  if (!track->mLast || track->mLast->mCount.load(std::memory_order_relaxed) == Block::SIZE) {
+    Block* block{new Block()};
+
+    if (track->mLast) {
+      track->mLast->mNext.store(block, std::memory_order_release);
+    } else {
+      track->mFirst.store(block, std::memory_order_release);
+    }
+
+    track->mLast = block;
+  }
+
+  size_t index{track->mLast->mCount.load(std::memory_order_relaxed)};
+  track->mLast->mEvents[index] = {name, start, end};
+  track->mLast->mCount.store(index + 1, std::memory_order_release);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+const char* Profiler::intern(std::string const& name) {
+  auto& registry = getRegistry();
+
+  std::lock_guard<std::mutex> lock(registry.mMutex);
+  return registry.mNames.insert(name).first->c_str();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::setThreadName(std::string const& name) {
+  auto& track = getThreadTrack();
+
+  std::lock_guard<std::mutex> lock(getRegistry().mMutex);
+  track.mName = name;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::clear() {
+  uint64_t time{now()};
+
+  std::lock_guard<std::mutex> lock(getRegistry().mMutex);
+  getRegistry().mClearTime = time;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::saveChromeTrace(std::string const& fileName) {
+  std::ofstream file(fileName);
+  if (!file) { throw std::runtime_error{"Failed to write trace \"" + fileName + "\"!"}; }
+
+  // the time stamps are relative to the first zone
+  uint64_t origin{std::numeric_limits<uint64_t>::max()};
+  forEachEvent([&origin](Track const&, Event const& event) {
+    origin = std::min(origin, event.mStart);
+  });
+
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+  file << std::fixed << std::setprecision(3);
+
+  bool first{true};
+
+  {
+    auto& registry = getRegistry();
+
+    std::lock_guard<std::mutex> lock(registry.mMutex);
+    for (auto const& track : registry.mTracks) {
+      if (track->mName.empty()) { continue; }
+
+      file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+           << track->mId << ",\"args\":{\"name\":\"" << escape(track->mName) << "\"}}";
+      first = false;
+    }
+  }
+
+  forEachEvent([&file, &first, origin](Track const& track, Event const& event) {
+    file << (first ? "" : ",\n") << "{\"name\":\"" << escape(event.mName)
+         << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << track.mId
+         << ",\"ts\":" << (event.mStart - origin) * 0.001
+         << ",\"dur\":" << (event.mEnd - event.mStart) * 0.001 << "}";
+    first = false;
+  });
+
+  file << "\n]}" << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::vector<Profiler::ZoneStatistics> Profiler::getStatistics() {
+  std::map<uint32_t, std::vector<Event>> tracks;
+  forEachEvent([&tracks](Track const& track, Event const& event) {
+    tracks[track.mId].push_back(event);
+  });
+
+  // ordering the paths as vectors of names yields a depth-first traversal
+  std::map<std::vector<std::string>, ZoneStatistics> zones;
+
+  for (auto& track : tracks) {
+    auto& events = track.second;
+
+    // parents come before their children
+    std::sort(events.begin(), events.end(), [](Event const& a, Event const& b) {
+      return a.mStart < b.mStart || (a.mStart == b.mStart && a.mEnd > b.mEnd);
+    });
+
+    std::vector<Event const*> parents;
+    std::vector<std::string>  path;
+
+    for (auto const& event : events) {
+      while (!parents.empty() && parents.back()->mEnd <= event.mStart) {
+        parents.pop_back();
+        path.pop_back();
+      }
+
+      parents.push_back(&event);
+      path.push_back(event.mName);
+
+      double duration{(event.mEnd - event.mStart) * 0.000001};
+      auto&  zone = zones[path];
+
+      if (zone.mCount == 0) {
+        zone.mName            = event.mName;
+        zone.mDepth           = static_cast<uint32_t>(path.size() - 1);
+        zone.mMinMilliseconds = duration;
+
+        for (auto const& name : path) {
+          zone.mPath += (zone.mPath.empty() ? "" : " / ") + name;
+        }
+      }
+
+      ++zone.mCount;
+      zone.mTotalMilliseconds += duration;
+      zone.mMinMilliseconds = std::min(zone.mMinMilliseconds, duration);
+      zone.mMaxMilliseconds = std::max(zone.mMaxMilliseconds, duration);
+    }
+  }
+
+  std::vector<ZoneStatistics> result;
+  for (auto const& zone : zones) {
+    result.push_back(zone.second);
+  }
+
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void Profiler::printStatistics() {
+  std::stringstream table;
+  table << std::setw(40) << std::left << "zone" << std::right
+        << " |    count |   total ms |  mean ms |   min ms |   max ms" << std::fixed
+        << std::setprecision(3);
+
+  for (auto const& zone : getStatistics()) {
+    table << std::endl
+          << std::setw(40) << std::left << std::string(zone.mDepth * 2, ' ') + zone.mName
+          << std::right << " | " << std::setw(8) << zone.mCount << " | " << std::setw(10)
+          << zone.mTotalMilliseconds << " | " << std::setw(8)
+          << zone.mTotalMilliseconds / zone.mCount << " | " << std::setw(8)
+          << zone.mMinMilliseconds << " | " << std::setw(8) << zone.mMaxMilliseconds;
+  }
+
+  ILLUSION_MESSAGE << table.str() << std::endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
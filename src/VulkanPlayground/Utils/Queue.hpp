@@ -8,24 +8,350 @@
 //                                                                                                //
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-#ifndef ILLUSION_QUEUE_HPP
-#define ILLUSION_QUEUE_HPP
+#ifndef ILLUSION_UTILS_QUEUE_HPP
+#define ILLUSION_UTILS_QUEUE_HPP
 
 // ---------------------------------------------------------------------------------------- includes
-#include "platform.hpp"
-
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 namespace Illusion {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-// A thread safe queue.                                                                           //
+// Thread safe queues. The BoundedQueue and the UnboundedQueue are lock-free and can be used by   //
+// any number of producers and consumers at once. The LockedQueue takes a mutex for each          //
+// operation; it is kept as a simple reference implementation.                                    //
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // -------------------------------------------------------------------------------------------------
+// A fixed-size ring of cells, each with a sequence number which tells producers and consumers
+// whether the cell is free for the current lap. A push or pop claims a cell with a single CAS. This
+// is the bounded MPMC queue by Dmitry Vyukov. T has to be default constructible.
+template <typename T>
+class BoundedQueue {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  // The capacity is rounded up to the next power of two.
+  explicit BoundedQueue(size_t capacity) {
+    size_t size{2};
+    while (size < capacity) {
+      size *= 2;
+    }
+
+    mMask = size - 1;
+    mCells.reset(new Cell[size]);
+
+    for (size_t i{0}; i < size; ++i) {
+      mCells[i].mSequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(BoundedQueue const& other) = delete;
+  BoundedQueue& operator=(BoundedQueue const& other) = delete;
+
+  // Returns false if the queue is full.
+  bool tryPush(T value) { return tryPush(&value, 1) == 1; }
+
+  // Returns false if the queue is empty.
+  bool tryPop(T& value) { return tryPop(&value, 1) == 1; }
+
+  // Pushes up to count values with a single CAS and returns how many have been pushed. The values
+  // are moved from.
+  size_t tryPush(T* values, size_t count) {
+    size_t position{mPushPosition.load(std::memory_order_relaxed)};
+
+    while (true) {
+      size_t available{countCells(position, count, 0)};
+      if (available == 0) {
+        // the first cell is either still occupied by a value of the last lap or another producer
+        // has claimed it already
+        size_t sequence{mCells[position & mMask].mSequence.load(std::memory_order_acquire)};
+        if (sequence < position) { return 0; }
+        position = mPushPosition.load(std::memory_order_relaxed);
+      } else if (mPushPosition.compare_exchange_weak(
+                   position, position + available, std::memory_order_relaxed)) {
+        for (size_t i{0}; i < available; ++i) {
+          Cell& cell  = mCells[(position + i) & mMask];
+          cell.mValue = std::move(values[i]);
+          cell.mSequence.store(position + i + 1, std::memory_order_release);
+        }
+        return available;
+      }
+    }
+  }
+
+  // Pops up to count values with a single CAS and returns how many have been popped.
+  size_t tryPop(T* values, size_t count) {
+    size_t position{mPopPosition.load(std::memory_order_relaxed)};
+
+    while (true) {
+      size_t available{countCells(position, count, 1)};
+      if (available == 0) {
+        size_t sequence{mCells[position & mMask].mSequence.load(std::memory_order_acquire)};
+        if (sequence < position + 1) { return 0; }
+        position = mPopPosition.load(std::memory_order_relaxed);
+      } else if (mPopPosition.compare_exchange_weak(
+                   position, position + available, std::memory_order_relaxed)) {
+        for (size_t i{0}; i < available; ++i) {
+          Cell& cell = mCells[(position + i) & mMask];
+          values[i]  = std::move(cell.mValue);
+          cell.mSequence.store(position + i + mMask + 1, std::memory_order_release);
+        }
+        return available;
+      }
+    }
+  }
+
+  // This is only a snapshot, it may be outdated as soon as it is returned.
+  size_t getApproximateSize() const {
+    size_t push{mPushPosition.load(std::memory_order_relaxed)};
+    size_t pop{mPopPosition.load(std::memory_order_relaxed)};
+    return push > pop ? push - pop : 0;
+  }
+
+  size_t getCapacity() const { return mMask + 1; }
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct Cell {
+    std::atomic<size_t> mSequence;
+    T                   mValue;
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  // returns how many consecutive cells starting at position are ready for a push (offset 0) or a
+  // pop (offset 1)
+  size_t countCells(size_t position, size_t count, size_t offset) const {
+    size_t available{0};
+    while (available < count && available <= mMask &&
+           mCells[(position + available) & mMask].mSequence.load(std::memory_order_acquire) ==
+             position + available + offset) {
+      ++available;
+    }
+    return available;
+  }
+
+  // ------------------------------------------------------------------------------- private members
+  std::unique_ptr<Cell[]> mCells;
+  size_t                  mMask;
+
+  // producers and consumers should not invalidate each other's cache lines
+  alignas(64) std::atomic<size_t> mPushPosition{0};
+  alignas(64) std::atomic<size_t> mPopPosition{0};
+};
+
+// -------------------------------------------------------------------------------------------------
+// A linked list of segments. Each slot of a segment is written only once: producers claim slots
+// with fetch_add and consumers with a CAS. Once all slots of a segment are claimed, producers
+// append a new segment. Consumers leave a segment once all of its slots have been popped. Segments
+// are retired when the consumers leave them and deleted once no push or pop is in progress anymore,
+// so under constant contention they are freed with some delay.
+template <typename T>
+class UnboundedQueue {
+
+ public:
+  // -------------------------------------------------------------------------------- public methods
+  explicit UnboundedQueue(size_t segmentSize = 1024)
+    : mSegmentSize(std::max<size_t>(1, segmentSize)) {
+
+    Segment* segment{new Segment(mSegmentSize)};
+    mHead.store(segment);
+    mTail.store(segment);
+  }
+
+  UnboundedQueue(UnboundedQueue const& other) = delete;
+  UnboundedQueue& operator=(UnboundedQueue const& other) = delete;
+
+  virtual ~UnboundedQueue() {
+    Segment* segment{mHead.load()};
+    while (segment) {
+      Segment* next{segment->mNext.load()};
+      delete segment;
+      segment = next;
+    }
+
+    deleteSegments(mRetired.load());
+  }
+
+  void push(T value) { push(&value, 1); }
+
+  // The values are moved from.
+  void push(T* values, size_t count) {
+    Operation operation(*this);
+
+    while (count > 0) {
+      Segment* segment{mTail.load()};
+      size_t   first{segment->mPushIndex.fetch_add(count)};
+
+      if (first < mSegmentSize) {
+        size_t pushed{std::min(count, mSegmentSize - first)};
+
+        for (size_t i{0}; i < pushed; ++i) {
+          Slot& slot  = segment->mSlots[first + i];
+          slot.mValue = std::move(values[i]);
+          slot.mReady.store(true, std::memory_order_release);
+        }
+
+        values += pushed;
+        count -= pushed;
+      }
+
+      if (count > 0) { advance(mTail, segment, true); }
+    }
+  }
+
+  // Returns false if the queue is empty. A value whose push is still in progress is not returned.
+  bool tryPop(T& value) {
+    Operation operation(*this);
+
+    while (true) {
+      Segment* segment{mHead.load()};
+      size_t   index{segment->mPopIndex.load()};
+
+      if (index >= mSegmentSize) {
+        if (!advance(mHead, segment, false)) { return false; }
+        continue;
+      }
+
+      if (!segment->mSlots[index].mReady.load(std::memory_order_acquire)) { return false; }
+
+      if (segment->mPopIndex.compare_exchange_weak(index, index + 1)) {
+        value = std::move(segment->mSlots[index].mValue);
+        return true;
+      }
+    }
+  }
+
+  // Pops up to count values and returns how many have been popped.
+  size_t tryPop(T* values, size_t count) {
+    size_t popped{0};
+    while (popped < count && tryPop(values[popped])) {
+      ++popped;
+    }
+    return popped;
+  }
+
+ private:
+  // ------------------------------------------------------------------------------- private classes
+  struct Slot {
+    std::atomic<bool> mReady{false};
+    T                 mValue;
+  };
+
+  struct Segment {
+    Segment(size_t size)
+      : mSlots(new Slot[size]) {}
+
+    std::unique_ptr<Slot[]> mSlots;
+    std::atomic<size_t>     mPushIndex{0};
+    std::atomic<size_t>     mPopIndex{0};
+    std::atomic<Segment*>   mNext{nullptr};
+
+    // used for the list of retired segments
+    Segment* mNextRetired{nullptr};
+  };
+
+  // counts the pushes and pops in progress and deletes retired segments once there are none
+  class Operation {
+   public:
+    Operation(UnboundedQueue& queue)
+      : mQueue(queue) {
+      ++mQueue.mOperations;
+    }
+
+    ~Operation() {
+      if (--mQueue.mOperations == 0 && mQueue.mRetired.load() != nullptr) {
+        Segment* retired{mQueue.mRetired.exchange(nullptr)};
+
+        // an operation which started before the segments were unlinked may still be running
+        if (mQueue.mOperations.load() == 0) {
+          deleteSegments(retired);
+        } else {
+          mQueue.retire(retired);
+        }
+      }
+    }
+
+   private:
+    UnboundedQueue& mQueue;
+  };
+
+  // ------------------------------------------------------------------------------- private methods
+  // Moves the given pointer from segment to its successor. Producers create the successor if there
+  // is none, consumers return false in this case. The consumer which unlinks a segment retires it.
+  bool advance(std::atomic<Segment*>& pointer, Segment* segment, bool create) {
+    Segment* next{segment->mNext.load()};
+
+    if (!next) {
+      if (!create) { return false; }
+
+      Segment* newSegment{new Segment(mSegmentSize)};
+      if (segment->mNext.compare_exchange_strong(next, newSegment)) {
+        next = newSegment;
+      } else {
+        delete newSegment;
+      }
+    }
+
+    if (create) {
+      pointer.compare_exchange_strong(segment, next);
+      return true;
+    }
+
+    // the tail must never point to a retired segment
+    Segment* tail{segment};
+    mTail.compare_exchange_strong(tail, next);
+
+    if (pointer.compare_exchange_strong(segment, next)) {
+      segment->mNextRetired = nullptr;
+      retire(segment);
+    }
+
+    return true;
+  }
+
+  // prepends a list of segments to the retired list
+  void retire(Segment* segments) {
+    if (!segments) { return; }
+
+    Segment* last{segments};
+    while (last->mNextRetired) {
+      last = last->mNextRetired;
+    }
+
+    Segment* head{mRetired.load()};
+    do {
+      last->mNextRetired = head;
+    } while (!mRetired.compare_exchange_weak(head, segments));
+  }
+
+  static void deleteSegments(Segment* segments) {
+    while (segments) {
+      Segment* next{segments->mNextRetired};
+      delete segments;
+      segments = next;
+    }
+  }
+
+  // ------------------------------------------------------------------------------- private members
+  size_t mSegmentSize;
+
+  alignas(64) std::atomic<Segment*> mHead{nullptr};
+  alignas(64) std::atomic<Segment*> mTail{nullptr};
+  alignas(64) std::atomic<uint32_t> mOperations{0};
+  std::atomic<Segment*> mRetired{nullptr};
+};
+
+// -------------------------------------------------------------------------------------------------
+// A std::queue protected by a mutex.
 template <class T>
-class ILLUSION_DLL Queue {
+class LockedQueue {
 
  public:
   // -------------------------------------------------------------------------------- public methods
@@ -73,4 +399,4 @@ class ILLUSION_DLL Queue {
 // -------------------------------------------------------------------------------------------------
 }
 
-#endif // ILLUSION_QUEUE_HPP
+#endif // ILLUSION_UTILS_QUEUE_HPP
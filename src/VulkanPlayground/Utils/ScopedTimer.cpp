@@ -12,7 +12,8 @@
 #include "ScopedTimer.hpp"
 
 #include "Logger.hpp"
-#include <chrono>
+#include "Profiler.hpp"
+
 #include <iostream>
 
 namespace Illusion {
@@ -21,19 +22,16 @@ namespace Illusion {
 
 ScopedTimer::ScopedTimer(std::string const& name)
   : mName(name)
-  , mStartTime(getNow()) {}
+  , mStartTime(Profiler::now()) {}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 ScopedTimer::~ScopedTimer() {
-  ILLUSION_DEBUG << mName << ": " << getNow() - mStartTime << " ms " << std::endl;
-}
+  uint64_t endTime{Profiler::now()};
 
-////////////////////////////////////////////////////////////////////////////////////////////////////
+  if (Profiler::enabled) { Profiler::record(Profiler::intern(mName), mStartTime, endTime); }
 
-double ScopedTimer::getNow() {
-  auto time{std::chrono::system_clock::now().time_since_epoch()};
-  return std::chrono::duration_cast<std::chrono::microseconds>(time).count() * 0.001;
+  ILLUSION_DEBUG << mName << ": " << (endTime - mStartTime) * 0.000001 << " ms " << std::endl;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
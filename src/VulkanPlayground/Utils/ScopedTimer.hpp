@@ -12,12 +12,15 @@
 #define ILLUSION_SCOPED_TIMER_HPP
 
 // ---------------------------------------------------------------------------------------- includes
+#include <cstdint>
 #include <string>
 
 namespace Illusion {
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
-// Can be used to measure time taken by some part of code.                                        //
+// Can be used to measure time taken by some part of code. The time is printed as debug message   //
+// and, if the Profiler is enabled, recorded as a zone. Use ILLUSION_PROFILE_ZONE instead if the  //
+// zone is entered very often.                                                                    //
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 class ScopedTimer {
@@ -27,12 +30,9 @@ class ScopedTimer {
   virtual ~ScopedTimer();
 
  private:
-  // ------------------------------------------------------------------------------- private methods
-  double getNow();
-
   // ------------------------------------------------------------------------------- private members
   std::string mName;
-  double      mStartTime;
+  uint64_t    mStartTime;
 };
 }
 
@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ILLUSION_UTILS_SPAN_HPP
+#define ILLUSION_UTILS_SPAN_HPP
+
+// ---------------------------------------------------------------------------------------- includes
+#include <cstddef>
+#include <stdexcept>
+
+namespace Illusion {
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// A non-owning view onto a contiguous range of elements. The memory it points to has to outlive  //
+// the span. Use Span<const T> for read-only views.                                               //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// -------------------------------------------------------------------------------------------------
+template <typename T>
+class Span {
+
+ public:
+  // ------------------------------------------------------------------------- contruction interface
+  Span()
+    : mData(nullptr)
+    , mSize(0) {}
+
+  Span(T* data, size_t size)
+    : mData(data)
+    , mSize(size) {}
+
+  // allows implicit conversion from Span<T> to Span<const T>
+  template <typename S>
+  Span(Span<S> const& other)
+    : mData(other.data())
+    , mSize(other.size()) {}
+
+  // -------------------------------------------------------------------------------- public methods
+  T*     data() const { return mData; }
+  size_t size() const { return mSize; }
+  size_t sizeInBytes() const { return mSize * sizeof(T); }
+  bool   empty() const { return mSize == 0; }
+
+  T* begin() const { return mData; }
+  T* end() const { return mData + mSize; }
+
+  T& operator[](size_t index) const { return mData[index]; }
+
+  // Returns a view onto count elements starting at offset. If count is larger than the remaining
+  // number of elements, the view is clamped to the end of this span.
+  Span<T> subspan(size_t offset, size_t count = static_cast<size_t>(-1)) const {
+    if (offset > mSize) { throw std::out_of_range{"Span offset is out of range!"}; }
+
+    return Span<T>(mData + offset, count < mSize - offset ? count : mSize - offset);
+  }
+
+ private:
+  // ------------------------------------------------------------------------------- private members
+  T*     mData;
+  size_t mSize;
+};
+}
+
+#endif // ILLUSION_UTILS_SPAN_HPP
@@ -44,6 +44,7 @@ typedef std::shared_ptr<vk::Instance>               VkInstancePtr;
 typedef std::shared_ptr<vk::PhysicalDevice>         VkPhysicalDevicePtr;
 typedef std::shared_ptr<vk::Pipeline>               VkPipelinePtr;
 typedef std::shared_ptr<vk::PipelineLayout>         VkPipelineLayoutPtr;
+typedef std::shared_ptr<vk::QueryPool>              VkQueryPoolPtr;
 typedef std::shared_ptr<vk::RenderPass>             VkRenderPassPtr;
 typedef std::shared_ptr<vk::Sampler>                VkSamplerPtr;
 typedef std::shared_ptr<vk::Semaphore>              VkSemaphorePtr;
@@ -51,17 +52,39 @@ typedef std::shared_ptr<vk::ShaderModule>           VkShaderModulePtr;
 typedef std::shared_ptr<vk::SurfaceKHR>             VkSurfaceKHRPtr;
 typedef std::shared_ptr<vk::SwapchainKHR>           VkSwapchainKHRPtr;
 
+// move-only alternatives for objects which have a single owner, see VulkanHandle.hpp
+template <typename T>
+class VulkanHandle;
+
+typedef VulkanHandle<vk::Fence>     VkFenceHandle;
+typedef VulkanHandle<vk::QueryPool> VkQueryPoolHandle;
+typedef VulkanHandle<vk::Semaphore> VkSemaphoreHandle;
+
 ILLUSION_DECLARE_STRUCT(Buffer);
 ILLUSION_DECLARE_STRUCT(Image);
 ILLUSION_DECLARE_STRUCT(FrameInfo);
+ILLUSION_DECLARE_STRUCT(MemoryAllocation);
 
 ILLUSION_DECLARE_CLASS(Device);
 ILLUSION_DECLARE_CLASS(Framebuffer);
+ILLUSION_DECLARE_CLASS(GpuProfiler);
 ILLUSION_DECLARE_CLASS(Instance);
+ILLUSION_DECLARE_CLASS(MemoryAllocator);
 ILLUSION_DECLARE_CLASS(PhysicalDevice);
+ILLUSION_DECLARE_CLASS(Pipeline);
+ILLUSION_DECLARE_CLASS(PipelineCache);
+ILLUSION_DECLARE_CLASS(PipelineCompiler);
+ILLUSION_DECLARE_CLASS(ResourceStateTracker);
+ILLUSION_DECLARE_CLASS(SamplerCache);
 ILLUSION_DECLARE_CLASS(ShaderReflection);
+ILLUSION_DECLARE_CLASS(ShaderReflectionCache);
+ILLUSION_DECLARE_CLASS(StagingRing);
+ILLUSION_DECLARE_CLASS(StreamingTexture);
 ILLUSION_DECLARE_CLASS(Surface);
 ILLUSION_DECLARE_CLASS(Texture);
+ILLUSION_DECLARE_CLASS(TextureCache);
+ILLUSION_DECLARE_CLASS(TextureStreamer);
+ILLUSION_DECLARE_CLASS(UploadContext);
 ILLUSION_DECLARE_CLASS(Window);
 }
 }
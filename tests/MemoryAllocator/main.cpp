@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+//                                                                                                //
+//   _)  |  |            _)                 This software may be modified and distributed         //
+//    |  |  |  |  | (_-<  |   _ \    \      under the terms of the MIT license.                   //
+//   _| _| _| \_,_| ___/ _| \___/ _| _|     See the LICENSE file for details.                     //
+//                                                                                                //
+//  Authors: Simon Schneegans (code@simonschneegans.de)                                           //
+//                                                                                                //
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <VulkanPlayground/Graphics/MemoryAllocator.hpp>
+
+#include <iostream>
+#include <map>
+#include <vector>
+
+// reports the failed condition but keeps going, so that one run shows all failures
+#define CHECK(CONDITION)                                                                           \
+  if (!(CONDITION)) {                                                                              \
+    std::cerr << __FILE__ << ":" << __LINE__ << ": Check failed: " #CONDITION << std::endl;        \
+    ++failures;                                                                                    \
+  }
+
+namespace {
+
+int failures{0};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef Illusion::Graphics::MemoryAllocator MemoryAllocator;
+
+const vk::DeviceSize PAGE_SIZE{64 * 1024};
+const vk::DeviceSize GRANULARITY{1024};
+const vk::DeviceSize ATOM_SIZE{256};
+
+const uint32_t DEVICE_LOCAL{0};
+const uint32_t HOST_VISIBLE{1};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Hands out host memory instead of device memory and records all calls.
+class FakeBackend : public MemoryAllocator::Backend {
+ public:
+  ~FakeBackend() {
+    for (auto& memory : mMemory) {
+      delete[] memory.second;
+    }
+  }
+
+  vk::DeviceMemory allocate(uint32_t memoryType, vk::DeviceSize size) override {
+    auto data = new uint8_t[size];
+    auto handle{vk::DeviceMemory(reinterpret_cast<VkDeviceMemory>(data))};
+    mMemory[handle] = data;
+    return handle;
+  }
+
+  void free(vk::DeviceMemory const& memory) override {
+    delete[] mMemory[memory];
+    mMemory.erase(memory);
+    ++mFreeCount;
+  }
+
+  void* map(vk::DeviceMemory const& memory, vk::DeviceSize size) override {
+    ++mMapCount;
+    return mMemory[memory];
+  }
+
+  void flush(vk::DeviceMemory const& memory, vk::DeviceSize offset, vk::DeviceSize size) override {
+    mFlushedRanges.push_back({offset, size});
+  }
+
+  std::map<vk::DeviceMemory, uint8_t*>                   mMemory;
+  uint32_t                                               mFreeCount{0};
+  uint32_t                                               mMapCount{0};
+  std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> mFlushedRanges;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// One device local and one host visible but not host coherent memory type, each on its own heap.
+std::shared_ptr<MemoryAllocator> createAllocator(std::shared_ptr<FakeBackend> const& backend) {
+  vk::PhysicalDeviceMemoryProperties properties;
+  properties.memoryTypeCount = 2;
+  properties.memoryHeapCount = 2;
+
+  properties.memoryTypes[DEVICE_LOCAL].propertyFlags = vk::MemoryPropertyFlagBits::eDeviceLocal;
+  properties.memoryTypes[DEVICE_LOCAL].heapIndex     = 0;
+  properties.memoryTypes[HOST_VISIBLE].propertyFlags = vk::MemoryPropertyFlagBits::eHostVisible;
+  properties.memoryTypes[HOST_VISIBLE].heapIndex     = 1;
+
+  properties.memoryHeaps[0].size = 1024 * 1024 * 1024;
+  properties.memoryHeaps[1].size = 1024 * 1024 * 1024;
+
+  return std::make_shared<MemoryAllocator>(backend, properties, GRANULARITY, ATOM_SIZE, PAGE_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Illusion::Graphics::MemoryAllocationPtr allocate(
+  std::shared_ptr<MemoryAllocator> const& allocator,
+  vk::DeviceSize                          size,
+  MemoryAllocator::ResourceType           type      = MemoryAllocator::ResourceType::eLinear,
+  vk::DeviceSize                          alignment = 16,
+  vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eDeviceLocal) {
+
+  vk::MemoryRequirements requirements;
+  requirements.size           = size;
+  requirements.alignment      = alignment;
+  requirements.memoryTypeBits = 0b11;
+
+  return allocator->allocate(requirements, properties, type);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testBestFit() {
+  auto backend   = std::make_shared<FakeBackend>();
+  auto allocator = createAllocator(backend);
+
+  auto a = allocate(allocator, 256);
+  auto b = allocate(allocator, 1024);
+  auto c = allocate(allocator, 256);
+  auto d = allocate(allocator, 128);
+  auto e = allocate(allocator, 256);
+
+  CHECK(a->mOffset == 0);
+  CHECK(b->mOffset == 256);
+  CHECK(c->mOffset == 1280);
+  CHECK(d->mOffset == 1536);
+  CHECK(e->mOffset == 1664);
+
+  // this leaves a hole of 1024 bytes and one of 128 bytes, the smaller one fits best
+  b.reset();
+  d.reset();
+
+  auto f = allocate(allocator, 64);
+  CHECK(f->mOffset == 1536);
+
+  auto g = allocate(allocator, 512);
+  CHECK(g->mOffset == 256);
+
+  auto statistics = allocator->getStatistics();
+  CHECK(statistics.mPageCount == 1);
+  CHECK(statistics.mAllocationCount == 5);
+  CHECK(statistics.mUsedBytes == 256 + 256 + 64 + 256 + 512);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testMerging() {
+  auto backend   = std::make_shared<FakeBackend>();
+  auto allocator = createAllocator(backend);
+
+  auto a = allocate(allocator, 256);
+  auto b = allocate(allocator, 256);
+  auto c = allocate(allocator, 256);
+
+  // the free ranges on both sides of b are merged with it
+  a.reset();
+  c.reset();
+  CHECK(allocator->getStatistics().mPages[0].mFreeRangeCount == 2);
+
+  b.reset();
+  auto statistics = allocator->getStatistics();
+  CHECK(statistics.mPages[0].mFreeRangeCount == 1);
+  CHECK(statistics.mPages[0].mLargestFreeRange == PAGE_SIZE);
+  CHECK(statistics.mFragmentation == 0.f);
+
+  // the last empty page of a memory type is kept
+  CHECK(statistics.mPageCount == 1);
+  CHECK(backend->mFreeCount == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testPages() {
+  auto backend   = std::make_shared<FakeBackend>();
+  auto allocator = createAllocator(backend);
+
+  // resources larger than half a page get a dedicated page which is released right away
+  auto dedicated = allocate(allocator, PAGE_SIZE);
+  CHECK(allocator->getStatistics().mPages[0].mIsDedicated);
+
+  dedicated.reset();
+  CHECK(allocator->getStatistics().mPageCount == 0);
+  CHECK(backend->mFreeCount == 1);
+
+  // a full page leads to a second one; only one of them is kept once both are empty
+  auto a = allocate(allocator, PAGE_SIZE / 2);
+  auto b = allocate(allocator, PAGE_SIZE / 2);
+  auto c = allocate(allocator, 256);
+  CHECK(allocator->getStatistics().mPageCount == 2);
+  CHECK(c->mMemory != a->mMemory);
+
+  a.reset();
+  b.reset();
+  c.reset();
+  CHECK(allocator->getStatistics().mPageCount == 1);
+  CHECK(backend->mFreeCount == 2);
+
+  // the allocations keep the allocator alive
+  auto d = allocate(allocator, 256);
+  allocator.reset();
+  d.reset();
+  CHECK(backend->mMemory.empty());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testGranularity() {
+  auto backend   = std::make_shared<FakeBackend>();
+  auto allocator = createAllocator(backend);
+
+  auto linear  = MemoryAllocator::ResourceType::eLinear;
+  auto optimal = MemoryAllocator::ResourceType::eOptimal;
+
+  // resources of the same type may share a granularity page
+  auto a = allocate(allocator, 64, linear);
+  auto b = allocate(allocator, 64, linear);
+  CHECK(b->mOffset == 64);
+
+  // resources of different types may not
+  auto c = allocate(allocator, 64, optimal);
+  CHECK(c->mOffset == GRANULARITY);
+
+  auto d = allocate(allocator, 64, optimal);
+  CHECK(d->mOffset == GRANULARITY + 64);
+
+  auto e = allocate(allocator, 64, optimal);
+  CHECK(e->mOffset == GRANULARITY + 128);
+
+  // the hole left by b is on the granularity page of a, so it cannot take an optimal resource
+  b.reset();
+  auto f = allocate(allocator, 64, optimal);
+  CHECK(f->mOffset == GRANULARITY + 192);
+
+  // a linear resource in front of c and d must end before their granularity page
+  a.reset();
+  auto g = allocate(allocator, GRANULARITY - 64, linear);
+  CHECK(g->mOffset == 0);
+  CHECK(g->mOffset + g->mSize <= GRANULARITY);
+
+  auto h = allocate(allocator, 64, linear);
+  CHECK(h->mOffset == GRANULARITY - 64);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void testNonCoherentMemory() {
+  auto backend   = std::make_shared<FakeBackend>();
+  auto allocator = createAllocator(backend);
+
+  auto host = vk::MemoryPropertyFlagBits::eHostVisible;
+
+  // sizes and offsets are rounded to the atom size, so flushes never touch other allocations
+  auto a = allocate(allocator, 100, MemoryAllocator::ResourceType::eLinear, 16, host);
+  auto b = allocate(allocator, 100, MemoryAllocator::ResourceType::eLinear, 16, host);
+
+  CHECK(a->mMemoryType == HOST_VISIBLE);
+  CHECK(!allocator->isHostCoherent(*a));
+  CHECK(a->mSize == ATOM_SIZE);
+  CHECK(b->mOffset == ATOM_SIZE);
+
+  allocator->flush(*b, 10, 20);
+  CHECK(backend->mFlushedRanges.size() == 1);
+  CHECK(backend->mFlushedRanges.back().first == ATOM_SIZE);
+  CHECK(backend->mFlushedRanges.back().second == ATOM_SIZE);
+
+  // the page is mapped once
+  auto dataA = static_cast<uint8_t*>(allocator->map(*a));
+  auto dataB = static_cast<uint8_t*>(allocator->map(*b));
+  CHECK(dataB - dataA == static_cast<std::ptrdiff_t>(ATOM_SIZE));
+  CHECK(backend->mMapCount == 1);
+
+  // device local memory cannot be mapped
+  auto c      = allocate(allocator, 100);
+  bool thrown = false;
+  try {
+    allocator->map(*c);
+  } catch (std::runtime_error const&) { thrown = true; }
+  CHECK(thrown);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+}
+
+int main(int argc, char* argv[]) {
+  testBestFit();
+  testMerging();
+  testPages();
+  testGranularity();
+  testNonCoherentMemory();
+
+  if (failures > 0) {
+    std::cerr << failures << " checks failed." << std::endl;
+    return 1;
+  }
+
+  return 0;
+}